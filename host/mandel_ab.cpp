@@ -0,0 +1,197 @@
+// in-process A/B benchmark of the configurations linked into the program
+// the variants run the same scenarios alternately so that they see the same machine state
+//
+// usage: mandel_ab [-r repeat] [-j threads] [-l] [scenario ...]
+//   -l: list the variants
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "tiny_mandelbrot_config.hpp"
+#include "thread_pool_executor.hpp"
+#include "mandel_variant.hpp"
+
+using namespace tinymandelbrot;
+
+struct ab_result_t {
+    int frames = 0;
+    uint64_t ns = 0;
+    uint64_t pixels = 0;
+    uint64_t loops = 0;
+
+    // pixels different from the first variant at the end of the scenario
+    int mismatch = 0;
+};
+
+// clock for time limited render()
+static uint32_t now_us() {
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+}
+
+// measure render() calls until the frame completes
+static void measure_render(MandelVariant &mandel, ab_result_t &result) {
+    auto t_start = std::chrono::steady_clock::now();
+    while (!mandel.render()) { }
+    auto t_end = std::chrono::steady_clock::now();
+    auto s = mandel.frame_stats();
+    result.frames++;
+    result.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
+    result.pixels += s.pixels;
+    result.loops += s.loops;
+}
+
+static double q24_to_double(uint32_t raw) {
+    return (double)(int32_t)raw / (1 << 24);
+}
+
+// deepest zoom level without perturbation
+static constexpr int BENCH_ZOOM = BENCHMARK_ZOOM < MAX_ZOOM ? BENCHMARK_ZOOM : MAX_ZOOM;
+
+static void move_to_benchmark(MandelVariant &mandel, int zoom) {
+    mandel.set_view(q24_to_double(BENCHMARK_A), q24_to_double(BENCHMARK_B), zoom);
+}
+
+// full redraw at the initial view
+static void scenario_full_home(MandelVariant &mandel, ab_result_t &result) {
+    mandel.set_view(-0.5, 0, 0);
+    measure_render(mandel, result);
+}
+
+// full redraw at the benchmark view
+static void scenario_full_bench(MandelVariant &mandel, ab_result_t &result) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    measure_render(mandel, result);
+}
+
+// horizontal scrolls at the benchmark view
+static void scenario_scroll_h(MandelVariant &mandel, ab_result_t &result) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    while (!mandel.render()) { }
+    for (int i = 0; i < 32; i++) {
+        mandel.scroll(4, 0);
+        measure_render(mandel, result);
+    }
+}
+
+// zoom in step by step toward the benchmark view
+static void scenario_zoom_in(MandelVariant &mandel, ab_result_t &result) {
+    move_to_benchmark(mandel, 0);
+    while (!mandel.render()) { }
+    while (mandel.zoom() < BENCH_ZOOM && mandel.zoom_in()) {
+        measure_render(mandel, result);
+    }
+}
+
+struct scenario_t {
+    const char *name;
+    void (*func)(MandelVariant &mandel, ab_result_t &result);
+};
+
+static const scenario_t SCENARIOS[] = {
+    { "full_home",  scenario_full_home  },
+    { "full_bench", scenario_full_bench },
+    { "scroll_h",   scenario_scroll_h   },
+    { "zoom_in",    scenario_zoom_in    },
+};
+
+static bool is_selected(const char *name, int argc, char **argv, int first) {
+    if (first >= argc) return true;
+    for (int i = first; i < argc; i++) {
+        if (strcmp(name, argv[i]) == 0) return true;
+    }
+    return false;
+}
+
+static int count_mismatch(const MandelVariant &a, const MandelVariant &b) {
+    if (a.width() != b.width() || a.height() != b.height()) return -1;
+    int num = 0;
+    for (int y = 0; y < a.height(); y++) {
+        for (int x = 0; x < a.width(); x++) {
+            if (a.count(x, y) != b.count(x, y)) num++;
+        }
+    }
+    return num;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 10;
+    int threads = 1;
+    int first = 1;
+    bool list = false;
+    while (first < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-l") == 0) {
+            list = true;
+            first++;
+            continue;
+        }
+        if (first + 1 >= argc) break;
+        if (strcmp(argv[first], "-r") == 0) {
+            repeat = atoi(argv[first + 1]);
+        }
+        else if (strcmp(argv[first], "-j") == 0) {
+            threads = atoi(argv[first + 1]);
+        }
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[first]);
+            return 1;
+        }
+        first += 2;
+    }
+    if (repeat < 1) repeat = 1;
+    if (threads < 1) threads = 1;
+
+    ThreadPoolExecutor executor(threads);
+    std::vector<MandelVariant *> variants;
+    for (auto *entry = variant_list(); entry; entry = entry->next) {
+        auto *mandel = entry->create();
+        mandel->set_executor(&executor);
+        mandel->set_clock(now_us);
+        variants.push_back(mandel);
+        if (list) {
+            printf("%s (%dx%d)\n", mandel->name(), mandel->width(), mandel->height());
+        }
+    }
+    if (list || variants.empty()) return 0;
+
+    printf("# repeat=%d, threads=%d, mismatch: pixels different from %s\n",
+        repeat, threads, variants[0]->name());
+    printf("%-12s %-32s %8s %12s %10s %12s %9s\n",
+        "scenario", "variant", "frames", "ns/frame", "pixels", "loops", "mismatch");
+
+    for (auto &scenario : SCENARIOS) {
+        if (!is_selected(scenario.name, argc, argv, first)) continue;
+
+        std::vector<ab_result_t> results(variants.size());
+        for (int i = 0; i < repeat; i++) {
+            // the variants take turns
+            for (size_t v = 0; v < variants.size(); v++) {
+                variants[v]->reset();
+                scenario.func(*variants[v], results[v]);
+            }
+        }
+        for (size_t v = 0; v < variants.size(); v++) {
+            results[v].mismatch = count_mismatch(*variants[0], *variants[v]);
+        }
+
+        for (size_t v = 0; v < variants.size(); v++) {
+            auto &result = results[v];
+            int frames = result.frames > 0 ? result.frames : 1;
+            printf("%-12s %-32s %8d %12llu %10llu %12llu %9d\n",
+                scenario.name,
+                variants[v]->name(),
+                result.frames,
+                (unsigned long long)(result.ns / frames),
+                (unsigned long long)(result.pixels / frames),
+                (unsigned long long)(result.loops / frames),
+                result.mismatch);
+        }
+    }
+
+    for (auto *mandel : variants) {
+        delete mandel;
+    }
+    return 0;
+}
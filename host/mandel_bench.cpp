@@ -0,0 +1,270 @@
+// TinyMandelbrot::render() benchmark for host build
+//
+// usage: mandel_bench [-r repeat] [-j threads] [-s 0|1] [scenario ...]
+//   -s 1: dump the statistics of every frame
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "tiny_mandelbrot.hpp"
+#include "thread_pool_executor.hpp"
+
+using namespace tinymandelbrot;
+
+// Q8.24 value to elem_t
+static elem_t q24_to_elem(uint32_t raw) {
+    return FIXED((double)(int32_t)raw / (1 << 24));
+}
+
+struct bench_result_t {
+    int frames = 0;
+    uint64_t ns = 0;
+    uint64_t pixels = 0;
+    uint64_t loops = 0;
+};
+
+// dump frame_stats() of every completed frame (-s 1)
+static bool dump_stats = false;
+
+static void print_frame_stats(const render_stats_t &s) {
+    printf("  frame calls=%u us=%u scan_us=%u fill_us=%u"
+        " pixels=%u cached=%u filled=%u interior=%u reused=%u"
+        " loops=%u max_escaped=%u refs=%u queue_peak=%u overflows=%u\n",
+        s.calls, s.total_us, s.scan_us, s.fill_us,
+        s.pixels, s.cached, s.filled, s.interior, s.reused,
+        s.loops, s.max_escaped, s.refs, s.queue_peak, s.overflows);
+}
+
+// clock for time limited render()
+static uint32_t now_us() {
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+}
+
+// measure render() calls until the frame completes
+static void measure_render(TinyMandelbrot &mandel, bench_result_t &result, uint32_t budget_us = 0) {
+    auto t_start = std::chrono::steady_clock::now();
+    bool complete;
+    do {
+        complete = mandel.render(budget_us);
+        result.pixels += mandel.stats.pixels;
+        result.loops += mandel.stats.loops;
+    } while (!complete);
+    auto t_end = std::chrono::steady_clock::now();
+    if (dump_stats) {
+        print_frame_stats(mandel.frame_stats());
+    }
+    result.frames++;
+    result.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
+}
+
+// deepest zoom level without perturbation
+static constexpr int BENCH_ZOOM = BENCHMARK_ZOOM < MAX_ZOOM ? BENCHMARK_ZOOM : MAX_ZOOM;
+
+static void move_to_benchmark(TinyMandelbrot &mandel, int zoom) {
+    mandel.set_zoom(zoom);
+    mandel.set_pos(q24_to_elem(BENCHMARK_A), q24_to_elem(BENCHMARK_B));
+    mandel.invalidate_buffer();
+}
+
+// full redraw at the initial view
+static void scenario_full_home(TinyMandelbrot &mandel, bench_result_t &result) {
+    mandel.set_zoom(0);
+    mandel.set_pos(FIXED(-0.5), FIXED(0));
+    mandel.invalidate_buffer();
+    measure_render(mandel, result);
+}
+
+// full redraw at the benchmark view
+static void scenario_full_bench(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    measure_render(mandel, result);
+}
+
+// full redraw at the benchmark view split into 1ms slices
+static void scenario_full_sliced(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    measure_render(mandel, result, 1000);
+}
+
+// incremental scrolls at the benchmark view
+static void scenario_scroll(TinyMandelbrot &mandel, bench_result_t &result, int dx, int dy) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    mandel.render();
+    for (int i = 0; i < 32; i++) {
+        mandel.scroll(dx, dy);
+        measure_render(mandel, result);
+    }
+    for (int i = 0; i < 32; i++) {
+        mandel.scroll(-dx, -dy);
+        measure_render(mandel, result);
+    }
+}
+
+static void scenario_scroll_h(TinyMandelbrot &mandel, bench_result_t &result) {
+    scenario_scroll(mandel, result, 4, 0);
+}
+
+static void scenario_scroll_v(TinyMandelbrot &mandel, bench_result_t &result) {
+    scenario_scroll(mandel, result, 0, 4);
+}
+
+static void scenario_scroll_diag(TinyMandelbrot &mandel, bench_result_t &result) {
+    scenario_scroll(mandel, result, 3, 3);
+}
+
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_GUARD_BAND
+// horizontal scrolls with the guard band completed between frames (not measured)
+static void scenario_scroll_guard(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    mandel.render();
+    for (int dir = 1; dir >= -1; dir -= 2) {
+        for (int i = 0; i < 32; i++) {
+            mandel.render_guard(dir, 0);
+            mandel.scroll(4 * dir, 0);
+            measure_render(mandel, result);
+        }
+    }
+}
+#endif
+
+// pan a whole screen away and back at the benchmark view
+static void scenario_pan_back(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    mandel.render();
+    for (int i = 0; i < 8; i++) {
+        mandel.scroll(W / 8, 0);
+        measure_render(mandel, result);
+    }
+    for (int i = 0; i < 8; i++) {
+        mandel.scroll(-W / 8, 0);
+        measure_render(mandel, result);
+    }
+}
+
+// zoom in step by step toward the benchmark view
+static void scenario_zoom_in(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, 0);
+    mandel.render();
+    while (mandel.zoom() < BENCH_ZOOM && mandel.zoom_in()) {
+        measure_render(mandel, result);
+    }
+}
+
+// zoom out step by step from the benchmark view
+static void scenario_zoom_out(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, BENCH_ZOOM);
+    mandel.render();
+    while (mandel.zoom_out()) {
+        measure_render(mandel, result);
+    }
+}
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+// full redraw with perturbation beyond MAX_ZOOM
+static void scenario_full_deep(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, MAX_ZOOM + 8);
+    measure_render(mandel, result);
+}
+
+// zoom in step by step beyond MAX_ZOOM
+static void scenario_zoom_deep(TinyMandelbrot &mandel, bench_result_t &result) {
+    move_to_benchmark(mandel, MAX_ZOOM);
+    mandel.render();
+    while (mandel.zoom_in()) {
+        measure_render(mandel, result);
+    }
+}
+#endif
+
+struct scenario_t {
+    const char *name;
+    void (*func)(TinyMandelbrot &mandel, bench_result_t &result);
+};
+
+static const scenario_t SCENARIOS[] = {
+    { "full_home",   scenario_full_home   },
+    { "full_bench",  scenario_full_bench  },
+    { "full_sliced", scenario_full_sliced },
+    { "scroll_h",    scenario_scroll_h    },
+    { "scroll_v",    scenario_scroll_v    },
+    { "scroll_diag", scenario_scroll_diag },
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_GUARD_BAND
+    { "scroll_guard", scenario_scroll_guard },
+#endif
+    { "pan_back",    scenario_pan_back    },
+    { "zoom_in",     scenario_zoom_in     },
+    { "zoom_out",    scenario_zoom_out    },
+#if MANDEL_ENABLE_DEEP_ZOOM
+    { "full_deep",   scenario_full_deep   },
+    { "zoom_deep",   scenario_zoom_deep   },
+#endif
+};
+
+static bool is_selected(const char *name, int argc, char **argv, int first) {
+    if (first >= argc) return true;
+    for (int i = first; i < argc; i++) {
+        if (strcmp(name, argv[i]) == 0) return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 10;
+    int threads = 1;
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-r") == 0) {
+            repeat = atoi(argv[first + 1]);
+        }
+        else if (strcmp(argv[first], "-j") == 0) {
+            threads = atoi(argv[first + 1]);
+        }
+        else if (strcmp(argv[first], "-s") == 0) {
+            dump_stats = atoi(argv[first + 1]) != 0;
+        }
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[first]);
+            return 1;
+        }
+        first += 2;
+    }
+    if (repeat < 1) repeat = 1;
+    if (threads < 1) threads = 1;
+
+    static TinyMandelbrot mandel;
+    ThreadPoolExecutor executor(threads);
+    mandel.set_executor(&executor);
+    mandel.set_clock(now_us);
+
+    printf("# %dx%d, %s, repeat=%d, threads=%d\n", W, H,
+        MANDEL_ENABLE_FIXED_POINT ? "Q8.24" : "float", repeat, threads);
+    printf("%-12s %8s %12s %10s %12s\n",
+        "scenario", "frames", "ns/frame", "pixels", "loops");
+
+    for (auto &scenario : SCENARIOS) {
+        if (!is_selected(scenario.name, argc, argv, first)) continue;
+
+        bench_result_t result;
+        for (int i = 0; i < repeat; i++) {
+            // every run starts from the same iteration limit
+            mandel.set_max_loops(DEFAULT_LOOPS);
+#if MANDEL_ENABLE_TILE_CACHE
+            // every run starts without cached tiles
+            mandel.clear_cache();
+#endif
+            scenario.func(mandel, result);
+        }
+
+        int frames = result.frames > 0 ? result.frames : 1;
+        printf("%-12s %8d %12llu %10llu %12llu\n",
+            scenario.name,
+            result.frames,
+            (unsigned long long)(result.ns / frames),
+            (unsigned long long)(result.pixels / frames),
+            (unsigned long long)(result.loops / frames));
+    }
+
+    return 0;
+}
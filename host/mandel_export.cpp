@@ -0,0 +1,119 @@
+// export a large image rendered tile by tile for host build
+// the image is composed of screen sized (W x H) views rendered by TinyMandelbrot,
+// and each band of H rows is written to the PPM file as soon as it is complete,
+// so the memory use depends only on the image width
+//
+// usage: mandel_export -o file.ppm -s width height [-c a b] [-z zoom] [-l loops] [-j threads]
+//   -s width height: image size in pixels
+//   -c a b: center of the image (default -0.5 0)
+//   -z zoom: zoom level of the pixel size, fractions are rounded to 1 / ZOOM_SUBSTEPS (default 0)
+//   -l loops: iteration limit (default DEFAULT_LOOPS)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "tiny_mandelbrot.hpp"
+#include "thread_pool_executor.hpp"
+#include "mandel_palette.hpp"
+
+using namespace tinymandelbrot;
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    long width = 0, height = 0;
+    double center_a = -0.5, center_b = 0;
+    double zoom = 0;
+    int loops = DEFAULT_LOOPS;
+    int threads = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 2 < argc) {
+            width = atol(argv[++i]);
+            height = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 2 < argc) {
+            center_a = atof(argv[++i]);
+            center_b = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-z") == 0 && i + 1 < argc) {
+            zoom = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!path || width <= 0 || height <= 0) {
+        fprintf(stderr, "usage: %s -o file.ppm -s width height [-c a b] [-z zoom] [-l loops] [-j threads]\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    static TinyMandelbrot mandel;
+    ThreadPoolExecutor executor(threads);
+    mandel.set_executor(&executor);
+    mandel.set_zoom_level((int)lround(zoom * ZOOM_SUBSTEPS));
+    mandel.set_max_loops(loops);
+
+    // pixel (0, 0) of the image on the pixel grid of the zoom level
+    const coord_t step = mandel.pixel_size_coord();
+    const coord_t origin_a = mandel.round_coord(COORD(center_a)) - step * (width / 2);
+    const coord_t origin_b = mandel.round_coord(COORD(center_b)) - step * (height / 2);
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    fprintf(fp, "P6\n%ld %ld\n255\n", width, height);
+
+    // one band of tiles
+    std::vector<uint8_t> band((size_t)width * H * 3);
+    long tiles_x = (width + W - 1) / W;
+    long tiles_y = (height + H - 1) / H;
+    for (long ty = 0; ty < tiles_y; ty++) {
+        int rows = (int)(height - ty * H < H ? height - ty * H : H);
+        for (long tx = 0; tx < tiles_x; tx++) {
+            int cols = (int)(width - tx * W < W ? width - tx * W : W);
+
+            // the pixel (W/2, H/2) of the view is at the view position
+            coord_t a = origin_a + step * (tx * W + W / 2);
+            coord_t b = origin_b + step * (ty * H + H / 2);
+
+            // every tile starts with the same iteration limit
+            mandel.set_max_loops(loops);
+            mandel.set_pos_coord(a, b);
+            mandel.invalidate_buffer();
+            // the tiles beyond VIEW_RANGE are outside the set as a whole
+            bool inside = mandel.a_coord() == a && mandel.b_coord() == b;
+            while (!mandel.render()) { }
+            int max_loops = mandel.max_loops();
+
+            for (int y = 0; y < rows; y++) {
+                uint8_t *wr_ptr = &band[((size_t)y * width + tx * W) * 3];
+                for (int x = 0; x < cols; x++) {
+                    int n = inside ? mandel.buff[pos_t(x, y)] : TinyMandelbrot::outside_count(max_loops);
+                    palette_color(n, max_loops, wr_ptr);
+                    wr_ptr += 3;
+                }
+            }
+        }
+
+        fwrite(band.data(), 3, (size_t)width * rows, fp);
+        fprintf(stderr, "\r%ld / %ld rows", ty * H + rows, height);
+    }
+    fprintf(stderr, "\n");
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef MANDEL_PALETTE_HPP
+#define MANDEL_PALETTE_HPP
+
+#include <stdint.h>
+
+namespace tinymandelbrot {
+
+// same palette as the PicoSystem app (4bit per component) in 8bit RGB
+static inline void palette_color(int n, int max_loops, uint8_t *rgb) {
+    if (n >= max_loops) {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        return;
+    }
+    int i = n % 256;
+    int k = (i & 0x7) * 2;
+    int r = 0, g = 0, b = 0;
+    switch ((i >> 3) % 6) {
+    case 0: r =    0; g =    0; b =    k; break;
+    case 1: r =    0; g =    k; b =   15; break;
+    case 2: r =    k; g =   15; b =   15; break;
+    case 3: r =   15; g =   15; b = 15-k; break;
+    case 4: r =   15; g = 15-k; b =    0; break;
+    case 5: r = 15-k; g =    0; b =    0; break;
+    }
+    rgb[0] = r * 17;
+    rgb[1] = g * 17;
+    rgb[2] = b * 17;
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,409 @@
+// regression check of TinyMandelbrot for host build
+// renders reference views and compares the count buffers and the timings
+// with the golden files recorded before
+// timings are relative to a plain raster of the home view with the kernel of this build,
+// measured in the same process, so that the recorded values mostly cancel out the speed of the machine
+//
+// usage: mandel_regress -g dir [-w] [-t permille] [-p ratio] [-r repeat] [view ...]
+//   -g dir: directory of the golden files (host/golden has the images of the raster builds)
+//   -w: record the golden files instead of checking
+//       (images are recorded only by exact builds (MANDEL_SCAN_RASTER without MANDEL_ENABLE_PROGRESSIVE),
+//        timings are recorded for each config variant, other builds check the images while recording)
+//   -t permille: mismatched pixels allowed for the scan modes that guess pixels (default 5)
+//   -p ratio: slowdown allowed against the recorded relative timings (default 1.5, 0: no timing check)
+//   -r repeat: timing is the fastest of the repeated renders (default 3)
+//
+// exit status is 1 when a view does not match
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "tiny_mandelbrot.hpp"
+
+using namespace tinymandelbrot;
+
+// Q8.24 value to elem_t
+static elem_t q24_to_elem(uint32_t raw) {
+    return FIXED((double)(int32_t)raw / (1 << 24));
+}
+
+// deepest zoom level without perturbation
+static constexpr int REGRESS_ZOOM = BENCHMARK_ZOOM < MAX_ZOOM ? BENCHMARK_ZOOM : MAX_ZOOM;
+
+// render until the frame completes with a stable iteration limit
+// returns the elapsed time
+static uint64_t render_stable(TinyMandelbrot &mandel) {
+    auto t_start = std::chrono::steady_clock::now();
+    do {
+        while (!mandel.render()) { }
+    } while (!mandel.no_change());
+    auto t_end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
+}
+
+// time of the kernel alone: all pixels of the home view in raster order
+// (best of repeat, loops: total escape count of the pixels)
+static uint64_t calibrate(int repeat, uint64_t *loops) {
+    count_t counts[W];
+    elem_t a[W], b[W];
+    for (int x = 0; x < W; x++) {
+        a[x] = FIXED(-0.5 + (double)(x - W / 2) / (1 << PIXEL_SCALE_BITS));
+    }
+    uint64_t ns = 0;
+    for (int i = 0; i < repeat; i++) {
+        *loops = 0;
+        auto t_start = std::chrono::steady_clock::now();
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                b[x] = FIXED((double)(y - H / 2) / (1 << PIXEL_SCALE_BITS));
+            }
+#if MANDEL_ENABLE_BATCH
+            mandelbrot_batch(a, b, counts, W, DEFAULT_LOOPS);
+#else
+            for (int x = 0; x < W; x++) {
+                counts[x] = mandelbrot_func(a[x], b[x], DEFAULT_LOOPS);
+            }
+#endif
+            for (int x = 0; x < W; x++) {
+                *loops += counts[x];
+            }
+        }
+        auto t_end = std::chrono::steady_clock::now();
+        uint64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
+        if (i == 0 || t < ns) ns = t;
+    }
+    return ns;
+}
+
+static void move_to_benchmark(TinyMandelbrot &mandel, int zoom) {
+    mandel.set_zoom(zoom);
+    mandel.set_pos(q24_to_elem(BENCHMARK_A), q24_to_elem(BENCHMARK_B));
+    mandel.invalidate_buffer();
+}
+
+// full redraw at the initial view
+static uint64_t view_home(TinyMandelbrot &mandel) {
+    mandel.set_zoom(0);
+    mandel.set_pos(FIXED(-0.5), FIXED(0));
+    mandel.invalidate_buffer();
+    return render_stable(mandel);
+}
+
+// full redraw at the benchmark view
+static uint64_t view_bench(TinyMandelbrot &mandel) {
+    move_to_benchmark(mandel, REGRESS_ZOOM);
+    return render_stable(mandel);
+}
+
+// the benchmark view after scrolls in all directions
+static uint64_t view_scroll(TinyMandelbrot &mandel) {
+    static const int8_t STEPS[][2] = { {5, 0}, {0, 7}, {-3, -3}, {W / 3, 2}, {-W / 3, -H / 4} };
+    move_to_benchmark(mandel, REGRESS_ZOOM);
+    uint64_t ns = render_stable(mandel);
+    for (auto &step : STEPS) {
+        for (int i = 0; i < 4; i++) {
+            mandel.scroll(step[0], step[1]);
+            ns += render_stable(mandel);
+        }
+    }
+    return ns;
+}
+
+// zoom in step by step toward the benchmark view, then zoom out halfway
+static uint64_t view_zoom(TinyMandelbrot &mandel) {
+    move_to_benchmark(mandel, 0);
+    uint64_t ns = render_stable(mandel);
+    while (mandel.zoom() < REGRESS_ZOOM && mandel.zoom_in()) {
+        ns += render_stable(mandel);
+    }
+    while (mandel.zoom() > REGRESS_ZOOM / 2 && mandel.zoom_out()) {
+        ns += render_stable(mandel);
+    }
+    return ns;
+}
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+// full redraw with perturbation beyond MAX_ZOOM
+static uint64_t view_deep(TinyMandelbrot &mandel) {
+    move_to_benchmark(mandel, MAX_ZOOM + 8);
+    return render_stable(mandel);
+}
+#endif
+
+// full redraw across a = -2, next to the views beyond VIEW_RANGE
+// (mandel_export fills the tiles it cannot center on with outside_count())
+static uint64_t view_edge(TinyMandelbrot &mandel) {
+    mandel.set_zoom(0);
+    mandel.set_pos(FIXED(-2.5), FIXED(0));
+    mandel.invalidate_buffer();
+    return render_stable(mandel);
+}
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+// the same with perturbation: the reference orbit at the view position escapes at once
+static uint64_t view_edge_deep(TinyMandelbrot &mandel) {
+    mandel.set_zoom(MAX_ZOOM + 8);
+    mandel.set_pos_coord(COORD(-2) - mandel.pixel_size_coord() * (W / 4), 0);
+    mandel.invalidate_buffer();
+    return render_stable(mandel);
+}
+#endif
+
+struct view_t {
+    const char *name;
+    uint64_t (*func)(TinyMandelbrot &mandel);
+
+    // the pixels beyond |a| = 2 or |b| = 2 are checked against outside_count()
+    bool outside;
+};
+
+static const view_t VIEWS[] = {
+    { "home",      view_home,      false },
+    { "bench",     view_bench,     false },
+    { "scroll",    view_scroll,    false },
+    { "zoom",      view_zoom,      false },
+#if MANDEL_ENABLE_DEEP_ZOOM
+    { "deep",      view_deep,      false },
+#endif
+    { "edge",      view_edge,      true  },
+#if MANDEL_ENABLE_DEEP_ZOOM
+    { "edge_deep", view_edge_deep, true  },
+#endif
+};
+
+// number of pixels beyond |a| = 2 or |b| = 2 that differ from outside_count()
+// (they would make a seam against the tiles beyond VIEW_RANGE in mandel_export)
+static int outside_mismatch(const TinyMandelbrot &mandel) {
+    const coord_t step = mandel.pixel_size_coord();
+    const count_t n = TinyMandelbrot::outside_count(mandel.max_loops());
+    int mismatch = 0;
+    for (int16_t y = 0; y < H; y++) {
+        coord_t b = mandel.b_coord() + step * (y - H / 2);
+        for (int16_t x = 0; x < W; x++) {
+            coord_t a = mandel.a_coord() + step * (x - W / 2);
+            bool outside = a <= COORD(-2) || COORD(2) <= a || b <= COORD(-2) || COORD(2) <= b;
+            if (outside && mandel.buff[pos_t(x, y)] != n) mismatch++;
+        }
+    }
+    return mismatch;
+}
+
+// arithmetic of this build (the split multiplication rounds differently)
+static const char *arith_name() {
+    return
+        !MANDEL_ENABLE_FIXED_POINT ? "float" :
+        MANDEL_ENABLE_MULT_SPLIT ? "q24split" : "q24";
+}
+
+// name of the config variant of this build
+static const char *variant_name() {
+    static char name[64];
+    const char *scan =
+        MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER ? "border" :
+        MANDEL_SCAN_MODE == MANDEL_SCAN_RECT ? "rect" : "raster";
+    const char *scroll = MANDEL_ENABLE_FAST_SCROLL ? "fast" : "redraw";
+    snprintf(name, sizeof(name), "%s_%s_%s", arith_name(), scan, scroll);
+    return name;
+}
+
+// golden image of the view (shared by the variants with the same arithmetic)
+static void image_path(char *path, size_t size, const char *dir, const char *view) {
+    snprintf(path, size, "%s/%s_%s.pgm", dir, view, arith_name());
+}
+
+// count buffer as PGM (16bit samples with MANDEL_ENABLE_WIDE_COUNT)
+static bool write_pgm(const char *path, const Buffer2D<count_t> &buff) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return false;
+    int max_val = sizeof(count_t) > 1 ? 65535 : 255;
+    fprintf(fp, "P5\n%d %d\n%d\n", buff.W, buff.H, max_val);
+    for (int16_t y = 0; y < buff.H; y++) {
+        for (int16_t x = 0; x < buff.W; x++) {
+            count_t n = buff[pos_t(x, y)];
+            if (sizeof(count_t) > 1) fputc((n >> 8) & 0xff, fp);
+            fputc(n & 0xff, fp);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+// returns false when the file is missing or has a different size
+static bool read_pgm(const char *path, count_t *data, int w, int h) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    int file_w, file_h, max_val;
+    bool ok = fscanf(fp, "P5 %d %d %d", &file_w, &file_h, &max_val) == 3 &&
+        file_w == w && file_h == h && fgetc(fp) != EOF;
+    for (int i = 0; ok && i < w * h; i++) {
+        int n = fgetc(fp);
+        if (max_val > 255) n = (n << 8) | fgetc(fp);
+        ok = n >= 0;
+        data[i] = (count_t)n;
+    }
+    fclose(fp);
+    return ok;
+}
+
+// recorded timings of the variant ("view ratio" per line, ratio: time / calibrate())
+struct perf_entry_t {
+    char view[16];
+    double ratio;
+};
+
+static int read_perf(const char *path, perf_entry_t *entries, int capacity) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    int num = 0;
+    while (num < capacity && fscanf(fp, "%15s %lf", entries[num].view, &entries[num].ratio) == 2) {
+        num++;
+    }
+    fclose(fp);
+    return num;
+}
+
+static bool is_selected(const char *name, int argc, char **argv, int first) {
+    if (first >= argc) return true;
+    for (int i = first; i < argc; i++) {
+        if (strcmp(name, argv[i]) == 0) return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    const char *dir = nullptr;
+    bool record = false;
+    int tolerance = 5;
+    double perf_ratio = 1.5;
+    int repeat = 3;
+    int first = 1;
+    while (first < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-w") == 0) {
+            record = true;
+            first++;
+            continue;
+        }
+        if (first + 1 >= argc) break;
+        if (strcmp(argv[first], "-g") == 0) {
+            dir = argv[first + 1];
+        }
+        else if (strcmp(argv[first], "-t") == 0) {
+            tolerance = atoi(argv[first + 1]);
+        }
+        else if (strcmp(argv[first], "-p") == 0) {
+            perf_ratio = atof(argv[first + 1]);
+        }
+        else if (strcmp(argv[first], "-r") == 0) {
+            repeat = atoi(argv[first + 1]);
+        }
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[first]);
+            return 1;
+        }
+        first += 2;
+    }
+    if (!dir) {
+        fprintf(stderr, "usage: %s -g dir [-w] [-t permille] [-p ratio] [-r repeat] [view ...]\n", argv[0]);
+        return 1;
+    }
+    if (repeat < 1) repeat = 1;
+
+    // the scan modes other than raster scan guess pixels from their neighbors
+    // (so do the coarse passes of MANDEL_ENABLE_PROGRESSIVE)
+    const bool exact = MANDEL_SCAN_MODE == MANDEL_SCAN_RASTER && !MANDEL_ENABLE_PROGRESSIVE;
+    const int allowed = exact ? 0 : W * H * tolerance / 1000;
+
+    char perf_path[512];
+    snprintf(perf_path, sizeof(perf_path), "%s/%s.perf", dir, variant_name());
+    perf_entry_t golden_perf[16];
+    int num_golden_perf = record ? 0 : read_perf(perf_path, golden_perf, 16);
+    FILE *perf_fp = nullptr;
+    if (record) {
+        perf_fp = fopen(perf_path, "w");
+        if (!perf_fp) {
+            fprintf(stderr, "cannot write %s\n", perf_path);
+            return 1;
+        }
+    }
+
+    static TinyMandelbrot mandel;
+    static count_t golden[W * H];
+
+    uint64_t calib_loops;
+    const uint64_t calib_ns = calibrate(repeat, &calib_loops);
+
+    printf("# %s, %s, calibration %llu ns (%llu loops)\n", variant_name(), record ? "record" : "check",
+        (unsigned long long)calib_ns, (unsigned long long)calib_loops);
+    printf("%-9s %10s %10s %12s %8s %8s %s\n", "view", "mismatch", "allowed", "ns", "ratio", "golden", "result");
+
+    int failures = 0;
+    for (auto &view : VIEWS) {
+        if (!is_selected(view.name, argc, argv, first)) continue;
+
+        uint64_t ns = 0;
+        for (int i = 0; i < repeat; i++) {
+            // every run starts from the same state
+            mandel.set_max_loops(DEFAULT_LOOPS);
+#if MANDEL_ENABLE_TILE_CACHE
+            mandel.clear_cache();
+#endif
+            uint64_t t = view.func(mandel);
+            if (i == 0 || t < ns) ns = t;
+        }
+
+        char path[512];
+        image_path(path, sizeof(path), dir, view.name);
+        bool ok = true;
+        int mismatch = -1;
+        if (record && exact) {
+            if (!write_pgm(path, mandel.buff)) {
+                fprintf(stderr, "cannot write %s\n", path);
+                ok = false;
+            }
+        }
+        else if (read_pgm(path, golden, W, H)) {
+            mismatch = 0;
+            for (int16_t y = 0; y < H; y++) {
+                for (int16_t x = 0; x < W; x++) {
+                    if (mandel.buff[pos_t(x, y)] != golden[y * W + x]) mismatch++;
+                }
+            }
+            ok = mismatch <= allowed;
+        }
+        else {
+            // images of the guessing builds would not be exact: record them with a raster build
+            fprintf(stderr, "missing golden image %s%s\n", path,
+                record ? " (recorded by the raster builds)" : "");
+            ok = record;
+        }
+
+        if (view.outside) {
+            int n = outside_mismatch(mandel);
+            if (n > 0) {
+                fprintf(stderr, "%s: %d pixels beyond |a| = 2 or |b| = 2 differ from outside_count()\n",
+                    view.name, n);
+                ok = false;
+            }
+        }
+
+        double ratio = (double)ns / calib_ns;
+        double golden_ratio = 0;
+        for (int i = 0; i < num_golden_perf; i++) {
+            if (strcmp(golden_perf[i].view, view.name) == 0) golden_ratio = golden_perf[i].ratio;
+        }
+        if (perf_fp) {
+            fprintf(perf_fp, "%s %.3f\n", view.name, ratio);
+        }
+        else if (perf_ratio > 0 && golden_ratio > 0 && ratio > golden_ratio * perf_ratio) {
+            ok = false;
+        }
+
+        if (!ok) failures++;
+        printf("%-9s %10d %10d %12llu %8.3f %8.3f %s\n",
+            view.name, mismatch, allowed, (unsigned long long)ns, ratio, golden_ratio, ok ? "ok" : "FAIL");
+    }
+
+    if (perf_fp) fclose(perf_fp);
+    return failures > 0 ? 1 : 0;
+}
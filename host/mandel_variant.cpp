@@ -0,0 +1,69 @@
+// MandelVariant implementation of one configuration
+// compiled once per variant with its own MANDEL_NAMESPACE and config switches
+// (see MANDEL_AB_VARIANTS in CMakeLists.txt)
+
+#include "tiny_mandelbrot.hpp"
+#include "mandel_variant.hpp"
+
+#define MANDEL_VARIANT_STR2(x) #x
+#define MANDEL_VARIANT_STR(x) MANDEL_VARIANT_STR2(x)
+
+namespace MANDEL_NAMESPACE {
+
+class Variant : public tinymandelbrot::MandelVariant {
+private:
+    TinyMandelbrot _mandel;
+
+    static tinymandelbrot::variant_stats_t convert(const render_stats_t &s) {
+        tinymandelbrot::variant_stats_t result;
+        result.pixels = s.pixels;
+        result.loops = s.loops;
+        result.cached = s.cached;
+        result.filled = s.filled;
+        result.reused = s.reused;
+        return result;
+    }
+
+public:
+    const char *name() const override { return MANDEL_VARIANT_STR(MANDEL_NAMESPACE); }
+    int width() const override { return W; }
+    int height() const override { return H; }
+
+    void set_executor(RenderExecutor *executor) override { _mandel.set_executor(executor); }
+    void set_clock(uint32_t (*clock)()) override { _mandel.set_clock(clock); }
+
+    void reset() override {
+        _mandel.set_max_loops(DEFAULT_LOOPS);
+#if MANDEL_ENABLE_TILE_CACHE
+        _mandel.clear_cache();
+#endif
+    }
+
+    void set_view(double a, double b, int zoom) override {
+        _mandel.set_zoom(zoom);
+        _mandel.set_pos_coord(COORD(a), COORD(b));
+        _mandel.invalidate_buffer();
+    }
+
+    void scroll(int dx, int dy) override { _mandel.scroll(dx, dy); }
+    bool zoom_in() override { return _mandel.zoom_in(); }
+    bool zoom_out() override { return _mandel.zoom_out(); }
+    int zoom() const override { return _mandel.zoom(); }
+
+    bool render(uint32_t budget_us) override { return _mandel.render(budget_us); }
+    bool no_change() const override { return _mandel.no_change(); }
+
+    int count(int x, int y) const override { return _mandel.buff[pos_t(x, y)]; }
+    int max_loops() const override { return _mandel.max_loops(); }
+
+    tinymandelbrot::variant_stats_t stats() const override { return convert(_mandel.stats); }
+    tinymandelbrot::variant_stats_t frame_stats() const override { return convert(_mandel.frame_stats()); }
+};
+
+static tinymandelbrot::MandelVariant *create_variant() {
+    return new Variant();
+}
+
+static tinymandelbrot::variant_registrar_t registrar(MANDEL_VARIANT_STR(MANDEL_NAMESPACE), create_variant);
+
+} // namespace
@@ -0,0 +1,82 @@
+#ifndef MANDEL_VARIANT_HPP
+#define MANDEL_VARIANT_HPP
+
+#include <stdint.h>
+#include "render_executor.hpp"
+
+namespace tinymandelbrot {
+
+// statistics of a frame (subset of render_stats_t independent of the configuration)
+struct variant_stats_t {
+    uint32_t pixels = 0;
+    uint32_t loops = 0;
+    uint32_t cached = 0;
+    uint32_t filled = 0;
+    uint32_t reused = 0;
+};
+
+// TinyMandelbrot of one configuration behind a common interface
+// each configuration is compiled from mandel_variant.cpp in its own MANDEL_NAMESPACE
+class MandelVariant {
+public:
+    virtual ~MandelVariant() { }
+
+    virtual const char *name() const = 0;
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+
+    virtual void set_executor(RenderExecutor *executor) = 0;
+    virtual void set_clock(uint32_t (*clock)()) = 0;
+
+    // iteration limit and tile cache back to the initial state
+    virtual void reset() = 0;
+
+    // move to (a, b) at the integer zoom level and clear the buffer
+    virtual void set_view(double a, double b, int zoom) = 0;
+
+    virtual void scroll(int dx, int dy) = 0;
+    virtual bool zoom_in() = 0;
+    virtual bool zoom_out() = 0;
+    virtual int zoom() const = 0;
+
+    virtual bool render(uint32_t budget_us = 0) = 0;
+    virtual bool no_change() const = 0;
+
+    // loop count of the pixel (0: not calculated)
+    virtual int count(int x, int y) const = 0;
+    virtual int max_loops() const = 0;
+
+    virtual variant_stats_t stats() const = 0;
+    virtual variant_stats_t frame_stats() const = 0;
+};
+
+// list of the configurations linked into the program
+struct variant_entry_t {
+    const char *name;
+    MandelVariant *(*create)();
+    variant_entry_t *next;
+};
+
+// head of the list (static initializers of mandel_variant.cpp register the configurations)
+inline variant_entry_t *&variant_list() {
+    static variant_entry_t *head = nullptr;
+    return head;
+}
+
+struct variant_registrar_t {
+    variant_entry_t entry;
+
+    variant_registrar_t(const char *name, MandelVariant *(*create)()) {
+        entry.name = name;
+        entry.create = create;
+        entry.next = nullptr;
+        // keep the registration order
+        auto **tail = &variant_list();
+        while (*tail) tail = &(*tail)->next;
+        *tail = &entry;
+    }
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,270 @@
+// zoom sequence renderer for host build
+// renders the frames along a path of keyframes and writes them as raw RGB24
+//
+// usage: mandel_video -k keyframes.txt -o file|- [-f frames_per_octave] [-l loops] [-j threads]
+//   keyframes.txt: one keyframe per line "a b zoom [frames]"
+//     frames: number of frames from the previous keyframe (default |zoom difference| * frames_per_octave)
+//   -o -: write to stdout, e.g. for
+//     mandel_video -k path.txt -o - | ffmpeg -f rawvideo -pix_fmt rgb24 -s 240x240 -r 30 -i - zoom.mp4
+//   -f frames_per_octave: default 30
+//   -l loops: iteration limit (default DEFAULT_LOOPS, raised with the zoom level by MIN_LOOPS)
+//
+// each frame is resampled from a source with pixels smaller than its own:
+//  - the source is 2 x 2 views at the zoom level one octave above the frame
+//    (in 1 / ZOOM_SUBSTEPS octave steps), so that one frame pixel covers 1 to 2 source pixels
+//    across and is the area weighted average of their colors (no magnification)
+//
+// consecutive frames reuse pixels through the engine:
+//  - each of ZOOM_SUBSTEPS sets of views takes the levels of one phase, so that its next level
+//    is one octave away and the pixel grids are aligned (MANDEL_ENABLE_ZOOM_REUSE)
+//  - moves between frames are scrolls (MANDEL_ENABLE_FAST_SCROLL)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "tiny_mandelbrot.hpp"
+#include "thread_pool_executor.hpp"
+#include "mandel_palette.hpp"
+
+using namespace tinymandelbrot;
+
+struct keyframe_t {
+    double a, b, zoom;
+    int frames;
+};
+
+static bool read_keyframes(const char *path, std::vector<keyframe_t> &keys) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        keyframe_t key = { 0, 0, 0, 0 };
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%lf %lf %lf %d", &key.a, &key.b, &key.zoom, &key.frames) >= 3) {
+            keys.push_back(key);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+// source pixels overlapped by one frame pixel (at most 3 when a frame pixel is 2 source pixels wide)
+struct box_taps_t {
+    int index[3];
+    float weight[3];
+
+    // the frame pixel spans [u - ratio / 2, u + ratio / 2) and source pixel i spans [i - 0.5, i + 0.5)
+    void set(double u, double ratio, int size) {
+        double lo = u - ratio / 2;
+        double hi = u + ratio / 2;
+        int first = (int)floor(lo + 0.5);
+        for (int i = 0; i < 3; i++) {
+            int x = first + i;
+            double w = fmin(hi, x + 0.5) - fmax(lo, x - 0.5);
+            index[i] = limit(0, size - 1, x);
+            weight[i] = w > 0 ? (float)(w / ratio) : 0;
+        }
+    }
+};
+
+class VideoRenderer {
+private:
+    // views per axis of the source
+    static constexpr int TILES = 2;
+    static constexpr int SRC_W = W * TILES;
+    static constexpr int SRC_H = H * TILES;
+
+    // views per phase of the source zoom level (level % ZOOM_SUBSTEPS)
+    TinyMandelbrot *_phases[ZOOM_SUBSTEPS][TILES * TILES];
+    int _loops;
+    uint8_t _source[SRC_W * SRC_H * 3];
+    uint8_t _frame[W * H * 3];
+    box_taps_t _x_taps[W];
+    box_taps_t _y_taps[H];
+
+public:
+    // calculated source pixels
+    uint64_t pixels = 0;
+    uint64_t frames = 0;
+
+    static constexpr uint64_t source_pixels() { return (uint64_t)SRC_W * SRC_H; }
+
+    VideoRenderer(RenderExecutor *executor, int loops) : _loops(loops) {
+        for (auto &views : _phases) {
+            for (auto &mandel : views) {
+                mandel = new TinyMandelbrot();
+                mandel->set_executor(executor);
+            }
+        }
+    }
+
+    ~VideoRenderer() {
+        for (auto &views : _phases) {
+            for (auto *mandel : views) {
+                delete mandel;
+            }
+        }
+    }
+
+    // render the frame centered at (a, b) and write it to fp
+    bool write_frame(FILE *fp, double a, double b, double zoom) {
+        const int max_level = TinyMandelbrot::max_zoom() * ZOOM_SUBSTEPS;
+        double z = fmin(fmax(zoom * ZOOM_SUBSTEPS, 0.0), (double)max_level);
+        int level = std::min((int)floor(z + 1e-9) + ZOOM_SUBSTEPS, max_level);
+        auto &views = _phases[level % ZOOM_SUBSTEPS];
+
+        // scroll at the previous level of the phase, then zoom by an octave
+        coord_t a_coord = COORD(a);
+        coord_t b_coord = COORD(b);
+        double size = exp2(-(double)level / ZOOM_SUBSTEPS) / (1 << PIXEL_SCALE_BITS);
+        for (int i = 0; i < TILES * TILES; i++) {
+            auto &mandel = *views[i];
+            mandel.set_pos_coord(
+                COORD(a + (i % TILES - 0.5) * W * size),
+                COORD(b + (i / TILES - 0.5) * H * size));
+            mandel.set_zoom_level(level);
+        }
+
+        // align the views to the source grid (left top source pixel x0, y0)
+        coord_t step = views[0]->pixel_size_coord();
+        int64_t x0 = views[0]->coord_to_pixel(a_coord) - W;
+        int64_t y0 = views[0]->coord_to_pixel(b_coord) - H;
+        for (int i = 0; i < TILES * TILES; i++) {
+            auto &mandel = *views[i];
+            int tx = i % TILES;
+            int ty = i / TILES;
+            mandel.set_pos_coord(
+                (x0 + tx * W + W / 2) * step,
+                (y0 + ty * H + H / 2) * step);
+
+            // every phase uses the same iteration limit (adaptive limits would flicker)
+            mandel.set_max_loops(_loops);
+            while (!mandel.render()) { }
+            pixels += mandel.frame_stats().pixels;
+
+            int max_loops = mandel.max_loops();
+            for (int y = 0; y < H; y++) {
+                uint8_t *wr_ptr = &_source[((ty * H + y) * SRC_W + tx * W) * 3];
+                for (int x = 0; x < W; x++) {
+                    palette_color(mandel.buff[pos_t(x, y)], max_loops, wr_ptr);
+                    wr_ptr += 3;
+                }
+            }
+        }
+        frames++;
+
+        // box filter: a frame pixel is ratio source pixels across
+        double ratio = exp2((level - z) / ZOOM_SUBSTEPS);
+        double u = (double)(a_coord - x0 * step) / step;
+        double v = (double)(b_coord - y0 * step) / step;
+        for (int x = 0; x < W; x++) {
+            _x_taps[x].set(u + (x - W / 2) * ratio, ratio, SRC_W);
+        }
+        for (int y = 0; y < H; y++) {
+            _y_taps[y].set(v + (y - H / 2) * ratio, ratio, SRC_H);
+        }
+        uint8_t *wr_ptr = _frame;
+        for (int y = 0; y < H; y++) {
+            auto &ty = _y_taps[y];
+            for (int x = 0; x < W; x++) {
+                auto &tx = _x_taps[x];
+                float rgb[3] = { 0, 0, 0 };
+                for (int j = 0; j < 3; j++) {
+                    const uint8_t *row = &_source[ty.index[j] * SRC_W * 3];
+                    for (int i = 0; i < 3; i++) {
+                        float w = ty.weight[j] * tx.weight[i];
+                        const uint8_t *px = &row[tx.index[i] * 3];
+                        rgb[0] += w * px[0];
+                        rgb[1] += w * px[1];
+                        rgb[2] += w * px[2];
+                    }
+                }
+                for (int c = 0; c < 3; c++) {
+                    *wr_ptr++ = (uint8_t)limit(0, 255, (int)lround(rgb[c]));
+                }
+            }
+        }
+        return fwrite(_frame, 3, W * H, fp) == (size_t)(W * H);
+    }
+};
+
+int main(int argc, char **argv) {
+    const char *key_path = nullptr;
+    const char *out_path = nullptr;
+    double frames_per_octave = 30;
+    int loops = DEFAULT_LOOPS;
+    int threads = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-k") == 0) {
+            key_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-o") == 0) {
+            out_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-f") == 0) {
+            frames_per_octave = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-l") == 0) {
+            loops = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-j") == 0) {
+            threads = atoi(argv[i + 1]);
+        }
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    std::vector<keyframe_t> keys;
+    if (!key_path || !out_path || !read_keyframes(key_path, keys) || keys.empty()) {
+        fprintf(stderr, "usage: %s -k keyframes.txt -o file|- [-f frames_per_octave] [-l loops] [-j threads]\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    FILE *fp = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "wb");
+    if (!fp) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 1;
+    }
+
+    ThreadPoolExecutor executor(threads);
+    static VideoRenderer renderer(&executor, loops);
+
+    bool ok = renderer.write_frame(fp, keys[0].a, keys[0].b, keys[0].zoom);
+    for (size_t i = 1; ok && i < keys.size(); i++) {
+        auto &k0 = keys[i - 1];
+        auto &k1 = keys[i];
+        int frames = k1.frames > 0 ? k1.frames : (int)lround(fabs(k1.zoom - k0.zoom) * frames_per_octave);
+        if (frames < 1) frames = 1;
+
+        double size0 = pow(2.0, -k0.zoom);
+        double size1 = pow(2.0, -k1.zoom);
+        for (int f = 1; ok && f <= frames; f++) {
+            double t = (double)f / frames;
+            double zoom = k0.zoom + (k1.zoom - k0.zoom) * t;
+
+            // the position moves with the view size so that the target stays at the same
+            // place on the screen while zooming
+            double u = size0 != size1 ? (size0 - pow(2.0, -zoom)) / (size0 - size1) : t;
+            ok = renderer.write_frame(fp,
+                k0.a + (k1.a - k0.a) * u,
+                k0.b + (k1.b - k0.b) * u,
+                zoom);
+        }
+        fprintf(stderr, "\rkeyframe %d / %d", (int)i + 1, (int)keys.size());
+    }
+    fprintf(stderr, "\n%llu frames, %.1f%% of the source pixels calculated\n",
+        (unsigned long long)renderer.frames,
+        100.0 * renderer.pixels / (renderer.frames * VideoRenderer::source_pixels()));
+
+    if (fp != stdout) fclose(fp);
+    if (!ok) {
+        fprintf(stderr, "write error\n");
+        return 1;
+    }
+    return 0;
+}
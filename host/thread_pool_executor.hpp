@@ -0,0 +1,111 @@
+#ifndef THREAD_POOL_EXECUTOR_HPP
+#define THREAD_POOL_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "render_executor.hpp"
+
+namespace tinymandelbrot {
+
+// runs render jobs on a pool of std::thread
+// the caller's thread also takes jobs, so N threads = N-1 workers + caller
+class ThreadPoolExecutor : public RenderExecutor {
+private:
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _start_cv;
+    std::condition_variable _done_cv;
+
+    // current batch
+    job_func_t _func = nullptr;
+    void *_context = nullptr;
+    int _num_jobs = 0;
+    std::atomic<int> _next_job{0};
+    int _running = 0;
+    uint32_t _generation = 0;
+    bool _quit = false;
+
+public:
+    ThreadPoolExecutor(int num_threads) {
+        for (int i = 1; i < num_threads; i++) {
+            _workers.emplace_back([this] { worker_main(); });
+        }
+    }
+
+    ~ThreadPoolExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _start_cv.notify_all();
+        for (auto &worker : _workers) {
+            worker.join();
+        }
+    }
+
+    int num_threads() const { return (int)_workers.size() + 1; }
+
+    void run(int num_jobs, job_func_t func, void *context) override {
+        if (_workers.empty()) {
+            RenderExecutor::run(num_jobs, func, context);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _func = func;
+            _context = context;
+            _num_jobs = num_jobs;
+            _next_job = 0;
+            _running = (int)_workers.size();
+            _generation++;
+        }
+        _start_cv.notify_all();
+
+        take_jobs(func, context, num_jobs);
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done_cv.wait(lock, [this] { return _running == 0; });
+    }
+
+private:
+    void take_jobs(job_func_t func, void *context, int num_jobs) {
+        int job;
+        while ((job = _next_job.fetch_add(1)) < num_jobs) {
+            func(context, job);
+        }
+    }
+
+    void worker_main() {
+        uint32_t generation = 0;
+        while (true) {
+            job_func_t func;
+            void *context;
+            int num_jobs;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _start_cv.wait(lock, [&] { return _quit || _generation != generation; });
+                if (_quit) return;
+                generation = _generation;
+                func = _func;
+                context = _context;
+                num_jobs = _num_jobs;
+            }
+
+            take_jobs(func, context, num_jobs);
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _running--;
+            }
+            _done_cv.notify_one();
+        }
+    }
+};
+
+} // namespace
+
+#endif
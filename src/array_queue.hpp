@@ -7,22 +7,27 @@ private:
     int _wr_ptr;
     int _rd_ptr;
     int _size;
+    bool _destroy;
 
 public:
     const int CAPACITY;
     const int INDEX_MASK;
     T *array;
 
-    ArrayQueue(int capacity_bits) :
-        CAPACITY(1 << capacity_bits), 
+    // storage: (1 << capacity_bits) elements owned by the caller (nullptr: allocated here)
+    ArrayQueue(int capacity_bits, T *storage = nullptr) :
+        _wr_ptr(0),
+        _rd_ptr(0),
+        _size(0),
+        _destroy(storage == nullptr),
+        CAPACITY(1 << capacity_bits),
         INDEX_MASK(CAPACITY - 1),
-        _wr_ptr(0), 
-        _rd_ptr(0), 
-        _size(0), 
-        array(new T[CAPACITY]) { }
+        array(storage ? storage : new T[CAPACITY]) { }
 
     ~ArrayQueue() {
-        delete[] array;
+        if (_destroy) {
+            delete[] array;
+        }
     }
 
     void clear() {
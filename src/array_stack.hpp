@@ -5,18 +5,23 @@ template<typename T>
 class ArrayStack {
 private:
     int _size;
+    bool _destroy;
 
 public:
     const int CAPACITY;
     T *array;
 
-    ArrayStack(int capacity) :
-        CAPACITY(capacity),
+    // storage: capacity elements owned by the caller (nullptr: allocated here)
+    ArrayStack(int capacity, T *storage = nullptr) :
         _size(0),
-        array(new T[capacity]) { }
+        _destroy(storage == nullptr),
+        CAPACITY(capacity),
+        array(storage ? storage : new T[capacity]) { }
 
     ~ArrayStack() {
-        delete[] array;
+        if (_destroy) {
+            delete[] array;
+        }
     }
 
     void clear() { _size = 0; }
@@ -1,6 +1,10 @@
 #ifndef BUFFER2D_UTILS
 #define BUFFER2D_UTILS
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 struct pos_t {
     int16_t x, y;
     pos_t() : x(0), y(0) {}
@@ -33,6 +37,11 @@ struct rect_t {
         return rect_t(x + dx, y + dy, w, h); 
     }
 
+    rect_t inset(int16_t d) const {
+        if (w <= d * 2 || h <= d * 2) return rect_t(x, y, 0, 0);
+        return rect_t(x + d, y + d, w - d * 2, h - d * 2);
+    }
+
     bool contains(pos_t pos) const {
         return
             x <= pos.x && pos.x < r() && 
@@ -66,10 +75,16 @@ public:
     T *data;
     bool destroy;
 
-    Buffer2D(int16_t w, int16_t h) : Buffer2D(w, h, w, new T[w * h], true) { }
+    // wrap mode: the buffer is a ring in both directions and scroll() only moves the origin
+    const bool WRAP;
 
-    Buffer2D(int16_t w, int16_t h, int16_t stride, T* data, bool destroy = false) 
-        : W(w), H(h), STRIDE(stride), data(data), destroy(destroy) { }
+    // position of the pixel (0, 0) in data (always 0 without WRAP)
+    int16_t x_origin, y_origin;
+
+    Buffer2D(int16_t w, int16_t h, bool wrap = false) : Buffer2D(w, h, w, new T[w * h], true, wrap) { }
+
+    Buffer2D(int16_t w, int16_t h, int16_t stride, T* data, bool destroy = false, bool wrap = false) 
+        : W(w), H(h), STRIDE(stride), data(data), destroy(destroy), WRAP(wrap), x_origin(0), y_origin(0) { }
 
     ~Buffer2D() {
         if (destroy) {
@@ -79,13 +94,41 @@ public:
     
     rect_t bounds() const { return rect_t(0, 0, W, H); }
 
-    T &operator[] (pos_t p) const { return data[p.y * STRIDE + p.x]; }
+    // position in data
+    int index(int16_t x, int16_t y) const {
+        int px = x + x_origin;
+        int py = y + y_origin;
+        if (px >= W) px -= W;
+        if (py >= H) py -= H;
+        return py * STRIDE + px;
+    }
+
+    T &operator[] (pos_t p) const { return data[index(p.x, p.y)]; }
+
+    // i: position in data
     T &operator[] (int i) const { return data[i]; }
     //T &operator[] (int x, int y) { return data[y * STRIDE + x]; }
     //T operator[] const (int x, int y) { return data[y * STRIDE + x]; }
 
-    T *ptr(pos_t p) const { return data + p.y * STRIDE + p.x; }
-    T *ptr(int16_t x, int16_t y) const { return data + y * STRIDE + x; }
+    // pixels after ptr(x, y) are contiguous up to the end of the row, or
+    // up to the wrapping point in wrap mode (see for_each_segment())
+    T *ptr(pos_t p) const { return data + index(p.x, p.y); }
+    T *ptr(int16_t x, int16_t y) const { return data + index(x, y); }
+
+    // call func(p, x, n) for each contiguous part of the pixels x0 to (x1 - 1) in the row y
+    // p points the pixel x (the row is split into two parts at most)
+    template<typename F>
+    void for_each_segment(int16_t y, int16_t x0, int16_t x1, F func) const {
+        if (x0 >= x1) return;
+        int16_t split = W - x_origin;
+        if (x0 < split && split < x1) {
+            func(ptr(x0, y), x0, (int16_t)(split - x0));
+            func(ptr(split, y), split, (int16_t)(x1 - split));
+        }
+        else {
+            func(ptr(x0, y), x0, (int16_t)(x1 - x0));
+        }
+    }
 
     void fill(T value = 0) {
         fill(bounds(), value);
@@ -93,17 +136,27 @@ public:
 
     void fill(rect_t rect, T value = 0) {
         rect = rect.intersect(bounds());
-        auto r = rect.r();
         auto b = rect.b();
         for (int16_t y = rect.y; y < b; y++) {
-            auto *wr_ptr = ptr(rect.x, y);
-            for (int16_t x = rect.x; x < r; x++) {
-                *(wr_ptr++) = value;
-            }
+            for_each_segment(y, rect.x, rect.r(), [&](T *wr_ptr, int16_t, int16_t n) {
+                for (int16_t i = 0; i < n; i++) {
+                    *(wr_ptr++) = value;
+                }
+            });
         }
     }
 
+    // move pixels by (dx, dy)
+    // the pixels scrolled in are left undefined
     void scroll(int16_t dx, int16_t dy) {
+        if (WRAP) {
+            x_origin = (int16_t)((x_origin - dx) % W);
+            y_origin = (int16_t)((y_origin - dy) % H);
+            if (x_origin < 0) x_origin += W;
+            if (y_origin < 0) y_origin += H;
+            return;
+        }
+
         int16_t y_src = 0, y_dst = 0;
         if (dy > 0) {
             y_src = 0;
@@ -149,20 +202,78 @@ public:
     }
 
     void line_copy(T *dst, T *src, int16_t n) {
-        if (dst < src) {
-            for (int16_t i = 0; i < n; i++) {
-                *(dst++) = *(src++);
-            }
+        if (n > 0) {
+            memmove(dst, src, sizeof(T) * n);
         }
-        else {
-            dst += n;
-            src += n;
-            for (int16_t i = 0; i < n; i++) {
-                *(--dst) = *(--src);
+    }
+
+    // move the origin of the wrap mode buffer back to data[0]
+    // so that the rows can be accessed with ptr() as a plain buffer
+    void linearize() {
+        if (x_origin != 0) {
+            for (int16_t y = 0; y < H; y++) {
+                rotate(data + y * STRIDE, W, x_origin);
             }
+            x_origin = 0;
+        }
+        if (y_origin != 0) {
+            rotate(data, STRIDE * H, STRIDE * y_origin);
+            y_origin = 0;
         }
     }
 
+private:
+    // rotate n elements left by k (p[k] comes to p[0])
+    static void rotate(T *p, int n, int k) {
+        reverse(p, 0, k);
+        reverse(p, k, n);
+        reverse(p, 0, n);
+    }
+
+    static void reverse(T *p, int i, int j) {
+        while (i < --j) {
+            T tmp = p[i];
+            p[i] = p[j];
+            p[j] = tmp;
+            i++;
+        }
+    }
+};
+
+// 1 bit per pixel
+// each row starts at a new word so that different rows can be updated in parallel
+class Bitmap2D {
+public:
+    const int16_t W, H, STRIDE;
+    uint32_t *data;
+    bool destroy;
+
+    // number of words for w x h pixels
+    static constexpr int words(int w, int h) { return (w + 31) / 32 * h; }
+
+    // storage: words(w, h) words owned by the caller (nullptr: allocated here)
+    Bitmap2D(int16_t w, int16_t h, uint32_t *storage = nullptr) :
+        W(w), H(h), STRIDE((w + 31) / 32),
+        data(storage ? storage : new uint32_t[words(w, h)]),
+        destroy(storage == nullptr) {
+        clear();
+    }
+
+    ~Bitmap2D() {
+        if (destroy) {
+            delete[] data;
+        }
+    }
+
+    bool get(pos_t p) const { return (data[p.y * STRIDE + (p.x >> 5)] >> (p.x & 31)) & 1; }
+    void set(pos_t p) { data[p.y * STRIDE + (p.x >> 5)] |= 1u << (p.x & 31); }
+    void reset(pos_t p) { data[p.y * STRIDE + (p.x >> 5)] &= ~(1u << (p.x & 31)); }
+
+    void clear() {
+        for (int i = 0; i < STRIDE * H; i++) {
+            data[i] = 0;
+        }
+    }
 };
 
 
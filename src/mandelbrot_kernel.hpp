@@ -0,0 +1,619 @@
+#ifndef MANDELBROT_KERNEL_HPP
+#define MANDELBROT_KERNEL_HPP
+
+#include <stdint.h>
+#include "tiny_mandelbrot_config.hpp"
+
+#if MANDEL_ENABLE_BATCH
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#endif
+
+namespace MANDEL_NAMESPACE {
+
+// generate fixed point value
+#if MANDEL_ENABLE_FIXED_POINT
+static inline elem_t FIXED(int val) { return ((elem_t)val) << FIXED_POINT_POS; }
+static inline elem_t FIXED(float val) { return (elem_t)(val * FIXED(1)); }
+static inline elem_t FIXED(double val) { return (elem_t)(val * FIXED(1)); }
+#else
+template<typename T>
+static inline elem_t FIXED(T val) { return (elem_t)val; }
+#endif
+
+// generate view position value
+static inline coord_t COORD(int val) { return ((coord_t)val) << COORD_POINT_POS; }
+static inline coord_t COORD(double val) { return (coord_t)(val * COORD(1)); }
+
+// convert between view position and elem_t
+#if MANDEL_ENABLE_FIXED_POINT
+static inline coord_t elem_to_coord(elem_t val) { return ((coord_t)val) << (COORD_POINT_POS - FIXED_POINT_POS); }
+static inline elem_t coord_to_elem(coord_t val) { return (elem_t)(val >> (COORD_POINT_POS - FIXED_POINT_POS)); }
+#else
+static inline coord_t elem_to_coord(elem_t val) { return COORD((double)val); }
+static inline elem_t coord_to_elem(coord_t val) { return (elem_t)((double)val / COORD(1)); }
+#endif
+static inline int16_t coord_to_q12(coord_t val) { return (int16_t)(val >> (COORD_POINT_POS - 12)); }
+static inline double coord_to_f64(coord_t val) { return (double)val / COORD(1); }
+
+// kernel precision
+enum precision_t {
+    PRECISION_Q12,  // int16_t Q4.12
+    PRECISION_Q24,  // int32_t Q8.24
+    PRECISION_F32,  // float
+    PRECISION_F64,  // double
+};
+
+// number of fraction bits of the precision
+static inline int precision_bits(precision_t p) {
+    switch (p) {
+    case PRECISION_Q12: return 12;
+    case PRECISION_Q24: return 24;
+    case PRECISION_F32: return 23;
+    default: return 52;
+    }
+}
+
+// mandelbrot calculation loop
+// returns the escape count (1 to max_loops, max_loops: did not escape)
+static inline count_t mandelbrot_func(elem_t a, elem_t b, int max_loops) {
+    elem_t x = 0, y = 0;
+    elem_t xx = 0;
+    elem_t yy = 0;
+    elem_t xy = 0;
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    elem_t px = 0, py = 0;
+    int check_len = PERIODICITY_CHECK_MIN, check_n = check_len;
+#endif
+    int n = max_loops;
+    do {
+#if MANDEL_ENABLE_FIXED_POINT
+#if MANDEL_ENABLE_MULT_SPLIT
+        int xysign = 1;
+        if (x < 0) { x = -x; xysign = -xysign; }
+        if (y < 0) { y = -y; xysign = -xysign; }
+
+        uint16_t xl = x & 0xffffu;
+        uint16_t xh = (x >> 16) & 0xffffu;
+        uint16_t yl = y & 0xffffu;
+        uint16_t yh = (y >> 16) & 0xffffu;
+
+        xy = (elem_t)xl * yl;
+        xy = (xy >> 16) & 0xffffu;
+        xy += (elem_t)xl * yh;
+        xy += (elem_t)xh * yl;
+        xy = (xy >> 8) & 0xffffffu;
+        xy += ((elem_t)xh * yh) << 8;
+        xy *= xysign;
+
+        xx = (elem_t)xl * xl;
+        xx = (xx >> 16) & 0xffffu;
+        xx += 2 * ((elem_t)xl * xh);
+        xx = (xx >> 8) & 0xffffffu;
+        xx += ((elem_t)xh * xh) << 8;
+        
+        yy = (elem_t)yl * yl;
+        yy = (yy >> 16) & 0xffffu;
+        yy += 2 * ((elem_t)yl * yh);
+        yy = (yy >> 8) & 0xffffffu;
+        yy += ((elem_t)yh * yh) << 8;
+#else
+        xy = (((int64_t)x * y) >> FIXED_POINT_POS) & 0xffffffffl;
+        xx = (((int64_t)x * x) >> FIXED_POINT_POS) & 0xffffffffl;
+        yy = (((int64_t)y * y) >> FIXED_POINT_POS) & 0xffffffffl;
+#endif
+#else
+        xy = x * y;
+        xx = x * x;
+        yy = y * y;
+#endif
+        x = xx - yy + a;
+        y = xy + xy + b;
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+        // the orbit came back to the snapshot: never escapes
+        if (x == px && y == py && xx + yy < FIXED(4)) return max_loops;
+        if (--check_n == 0) {
+            check_len <<= 1;
+            check_n = check_len;
+            px = x;
+            py = y;
+        }
+#endif
+    } while (--n != 0 && xx + yy < FIXED(4));
+    return max_loops - n;
+}
+
+// (a * b) >> COORD_POINT_POS, rounded toward zero
+static inline coord_t mul_coord(coord_t a, coord_t b) {
+    bool neg = (a < 0) != (b < 0);
+    uint64_t ua = a < 0 ? -(uint64_t)a : (uint64_t)a;
+    uint64_t ub = b < 0 ? -(uint64_t)b : (uint64_t)b;
+#ifdef __SIZEOF_INT128__
+    uint64_t prod = (uint64_t)(((unsigned __int128)ua * ub) >> COORD_POINT_POS);
+#else
+    uint64_t al = ua & 0xffffffffu, ah = ua >> 32;
+    uint64_t bl = ub & 0xffffffffu, bh = ub >> 32;
+    uint64_t ll = al * bl;
+    uint64_t lh = al * bh;
+    uint64_t hl = ah * bl;
+    uint64_t mid = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+    uint64_t lo = (ll & 0xffffffffu) | (mid << 32);
+    uint64_t hi = ah * bh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    uint64_t prod = (hi << (64 - COORD_POINT_POS)) | (lo >> COORD_POINT_POS);
+#endif
+    return neg ? -(coord_t)prod : (coord_t)prod;
+}
+
+// c = a + bi is in the main cardioid or the period-2 bulb
+static inline bool is_main_body(coord_t a, coord_t b) {
+    // bounding box of both
+    if (a < COORD(-1.25) || COORD(0.375) < a || b < COORD(-0.6875) || COORD(0.6875) < b) return false;
+
+    // period-2 bulb: (a + 1)^2 + b^2 < 1/16
+    coord_t bb = mul_coord(b, b);
+    coord_t a1 = a + COORD(1);
+    if (mul_coord(a1, a1) + bb < COORD(0.0625)) return true;
+
+    // main cardioid: q * (q + (a - 1/4)) < b^2 / 4, q = (a - 1/4)^2 + b^2
+    coord_t aq = a - COORD(0.25);
+    coord_t q = mul_coord(aq, aq) + bb;
+    return mul_coord(q, q + aq) < (bb >> 2);
+}
+
+#if MANDEL_ENABLE_FIXED_POINT
+// mandelbrot calculation loop (Q4.12)
+// |z| < 2 keeps x, y, xx, yy in range until the loop ends
+static inline count_t mandelbrot_func_q12(int16_t a, int16_t b, int max_loops) {
+    int16_t x = 0, y = 0;
+    int32_t xx = 0;
+    int32_t yy = 0;
+    int32_t xy = 0;
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    int16_t px = 0, py = 0;
+    int check_len = PERIODICITY_CHECK_MIN, check_n = check_len;
+#endif
+    int n = max_loops;
+    do {
+        xy = ((int32_t)x * y) >> 12;
+        xx = ((int32_t)x * x) >> 12;
+        yy = ((int32_t)y * y) >> 12;
+        x = xx - yy + a;
+        y = xy + xy + b;
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+        if (x == px && y == py && xx + yy < (4 << 12)) return max_loops;
+        if (--check_n == 0) {
+            check_len <<= 1;
+            check_n = check_len;
+            px = x;
+            py = y;
+        }
+#endif
+    } while (--n != 0 && xx + yy < (4 << 12));
+    return max_loops - n;
+}
+#endif
+
+// mandelbrot calculation loop (double)
+static inline count_t mandelbrot_func_f64(double a, double b, int max_loops) {
+    double x = 0, y = 0;
+    double xx = 0;
+    double yy = 0;
+    double xy = 0;
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    double px = 0, py = 0;
+    int check_len = PERIODICITY_CHECK_MIN, check_n = check_len;
+#endif
+    int n = max_loops;
+    do {
+        xy = x * y;
+        xx = x * x;
+        yy = y * y;
+        x = xx - yy + a;
+        y = xy + xy + b;
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+        if (x == px && y == py && xx + yy < 4) return max_loops;
+        if (--check_n == 0) {
+            check_len <<= 1;
+            check_n = check_len;
+            px = x;
+            py = y;
+        }
+#endif
+    } while (--n != 0 && xx + yy < 4);
+    return max_loops - n;
+}
+
+#if MANDEL_ENABLE_BATCH
+// batch calculation: BATCH_LANES points are iterated in lockstep
+// and each lane stops counting when it escapes
+#if defined(__AVX2__) || defined(__SSE4_1__)
+
+#if defined(__AVX2__)
+static constexpr int BATCH_LANES = 8;
+using ivec_t = __m256i;
+using fvec_t = __m256;
+static inline ivec_t vi_load(const int32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline void vi_store(int32_t *p, ivec_t v) { _mm256_storeu_si256((__m256i *)p, v); }
+static inline ivec_t vi_set1(int32_t v) { return _mm256_set1_epi32(v); }
+static inline ivec_t vi_add(ivec_t a, ivec_t b) { return _mm256_add_epi32(a, b); }
+static inline ivec_t vi_sub(ivec_t a, ivec_t b) { return _mm256_sub_epi32(a, b); }
+static inline ivec_t vi_and(ivec_t a, ivec_t b) { return _mm256_and_si256(a, b); }
+static inline ivec_t vi_or(ivec_t a, ivec_t b) { return _mm256_or_si256(a, b); }
+static inline ivec_t vi_andnot(ivec_t a, ivec_t b) { return _mm256_andnot_si256(a, b); }
+static inline ivec_t vi_blend(ivec_t a, ivec_t b, ivec_t m) { return _mm256_blendv_epi8(a, b, m); }
+static inline ivec_t vi_cmplt(ivec_t a, ivec_t b) { return _mm256_cmpgt_epi32(b, a); }
+static inline ivec_t vi_cmpeq(ivec_t a, ivec_t b) { return _mm256_cmpeq_epi32(a, b); }
+static inline bool vi_any(ivec_t m) { return !_mm256_testz_si256(m, m); }
+static inline fvec_t vf_load(const float *p) { return _mm256_loadu_ps(p); }
+static inline fvec_t vf_set1(float v) { return _mm256_set1_ps(v); }
+static inline fvec_t vf_add(fvec_t a, fvec_t b) { return _mm256_add_ps(a, b); }
+static inline fvec_t vf_sub(fvec_t a, fvec_t b) { return _mm256_sub_ps(a, b); }
+static inline fvec_t vf_mul(fvec_t a, fvec_t b) { return _mm256_mul_ps(a, b); }
+static inline ivec_t vf_cmplt(fvec_t a, fvec_t b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+static inline ivec_t vf_cmpeq(fvec_t a, fvec_t b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+
+// lane-wise (a * b) >> FIXED_POINT_POS
+static inline ivec_t vi_mul_fixed(ivec_t a, ivec_t b) {
+#if MANDEL_ENABLE_MULT_SPLIT
+    // round toward zero like the split multiplication
+    ivec_t sign = _mm256_or_si256(_mm256_xor_si256(a, b), _mm256_set1_epi32(1));
+    a = _mm256_abs_epi32(a);
+    b = _mm256_abs_epi32(b);
+    ivec_t even = _mm256_mul_epu32(a, b);
+    ivec_t odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+#else
+    ivec_t even = _mm256_mul_epi32(a, b);
+    ivec_t odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+#endif
+    even = _mm256_srli_epi64(even, FIXED_POINT_POS);
+    odd = _mm256_slli_epi64(odd, 32 - FIXED_POINT_POS);
+    ivec_t prod = _mm256_blend_epi32(even, odd, 0xaa);
+#if MANDEL_ENABLE_MULT_SPLIT
+    prod = _mm256_sign_epi32(prod, sign);
+#endif
+    return prod;
+}
+
+// 16bit lanes for Q4.12
+static constexpr int BATCH_LANES_16 = 16;
+static inline ivec_t vh_load(const int16_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline void vh_store(int16_t *p, ivec_t v) { _mm256_storeu_si256((__m256i *)p, v); }
+static inline ivec_t vh_set1(int16_t v) { return _mm256_set1_epi16(v); }
+static inline ivec_t vh_add(ivec_t a, ivec_t b) { return _mm256_add_epi16(a, b); }
+static inline ivec_t vh_sub(ivec_t a, ivec_t b) { return _mm256_sub_epi16(a, b); }
+static inline ivec_t vh_cmplt(ivec_t a, ivec_t b) { return _mm256_cmpgt_epi16(b, a); }
+static inline ivec_t vh_cmpeq(ivec_t a, ivec_t b) { return _mm256_cmpeq_epi16(a, b); }
+static inline ivec_t vh_abs(ivec_t a) { return _mm256_abs_epi16(a); }
+
+// lane-wise (a * b) >> 12
+static inline ivec_t vh_mul_q12(ivec_t a, ivec_t b) {
+    return _mm256_or_si256(
+        _mm256_slli_epi16(_mm256_mulhi_epi16(a, b), 4),
+        _mm256_srli_epi16(_mm256_mullo_epi16(a, b), 12));
+}
+
+// 64bit lanes for double
+static constexpr int BATCH_LANES_64 = 4;
+using dvec_t = __m256d;
+static inline ivec_t vq_set1(int64_t v) { return _mm256_set1_epi64x(v); }
+static inline ivec_t vq_sub(ivec_t a, ivec_t b) { return _mm256_sub_epi64(a, b); }
+static inline void vq_store(int64_t *p, ivec_t v) { _mm256_storeu_si256((__m256i *)p, v); }
+static inline dvec_t vd_load(const double *p) { return _mm256_loadu_pd(p); }
+static inline dvec_t vd_set1(double v) { return _mm256_set1_pd(v); }
+static inline dvec_t vd_add(dvec_t a, dvec_t b) { return _mm256_add_pd(a, b); }
+static inline dvec_t vd_sub(dvec_t a, dvec_t b) { return _mm256_sub_pd(a, b); }
+static inline dvec_t vd_mul(dvec_t a, dvec_t b) { return _mm256_mul_pd(a, b); }
+static inline ivec_t vd_cmplt(dvec_t a, dvec_t b) { return _mm256_castpd_si256(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }
+static inline ivec_t vd_cmpeq(dvec_t a, dvec_t b) { return _mm256_castpd_si256(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+#else
+static constexpr int BATCH_LANES = 4;
+using ivec_t = __m128i;
+using fvec_t = __m128;
+static inline ivec_t vi_load(const int32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void vi_store(int32_t *p, ivec_t v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline ivec_t vi_set1(int32_t v) { return _mm_set1_epi32(v); }
+static inline ivec_t vi_add(ivec_t a, ivec_t b) { return _mm_add_epi32(a, b); }
+static inline ivec_t vi_sub(ivec_t a, ivec_t b) { return _mm_sub_epi32(a, b); }
+static inline ivec_t vi_and(ivec_t a, ivec_t b) { return _mm_and_si128(a, b); }
+static inline ivec_t vi_or(ivec_t a, ivec_t b) { return _mm_or_si128(a, b); }
+static inline ivec_t vi_andnot(ivec_t a, ivec_t b) { return _mm_andnot_si128(a, b); }
+static inline ivec_t vi_blend(ivec_t a, ivec_t b, ivec_t m) { return _mm_blendv_epi8(a, b, m); }
+static inline ivec_t vi_cmplt(ivec_t a, ivec_t b) { return _mm_cmplt_epi32(a, b); }
+static inline ivec_t vi_cmpeq(ivec_t a, ivec_t b) { return _mm_cmpeq_epi32(a, b); }
+static inline bool vi_any(ivec_t m) { return !_mm_testz_si128(m, m); }
+static inline fvec_t vf_load(const float *p) { return _mm_loadu_ps(p); }
+static inline fvec_t vf_set1(float v) { return _mm_set1_ps(v); }
+static inline fvec_t vf_add(fvec_t a, fvec_t b) { return _mm_add_ps(a, b); }
+static inline fvec_t vf_sub(fvec_t a, fvec_t b) { return _mm_sub_ps(a, b); }
+static inline fvec_t vf_mul(fvec_t a, fvec_t b) { return _mm_mul_ps(a, b); }
+static inline ivec_t vf_cmplt(fvec_t a, fvec_t b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+static inline ivec_t vf_cmpeq(fvec_t a, fvec_t b) { return _mm_castps_si128(_mm_cmpeq_ps(a, b)); }
+
+// lane-wise (a * b) >> FIXED_POINT_POS
+static inline ivec_t vi_mul_fixed(ivec_t a, ivec_t b) {
+#if MANDEL_ENABLE_MULT_SPLIT
+    // round toward zero like the split multiplication
+    ivec_t sign = _mm_or_si128(_mm_xor_si128(a, b), _mm_set1_epi32(1));
+    a = _mm_abs_epi32(a);
+    b = _mm_abs_epi32(b);
+    ivec_t even = _mm_mul_epu32(a, b);
+    ivec_t odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+#else
+    ivec_t even = _mm_mul_epi32(a, b);
+    ivec_t odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+#endif
+    even = _mm_srli_epi64(even, FIXED_POINT_POS);
+    odd = _mm_slli_epi64(odd, 32 - FIXED_POINT_POS);
+    ivec_t prod = _mm_blend_epi16(even, odd, 0xcc);
+#if MANDEL_ENABLE_MULT_SPLIT
+    prod = _mm_sign_epi32(prod, sign);
+#endif
+    return prod;
+}
+
+// 16bit lanes for Q4.12
+static constexpr int BATCH_LANES_16 = 8;
+static inline ivec_t vh_load(const int16_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void vh_store(int16_t *p, ivec_t v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline ivec_t vh_set1(int16_t v) { return _mm_set1_epi16(v); }
+static inline ivec_t vh_add(ivec_t a, ivec_t b) { return _mm_add_epi16(a, b); }
+static inline ivec_t vh_sub(ivec_t a, ivec_t b) { return _mm_sub_epi16(a, b); }
+static inline ivec_t vh_cmplt(ivec_t a, ivec_t b) { return _mm_cmplt_epi16(a, b); }
+static inline ivec_t vh_cmpeq(ivec_t a, ivec_t b) { return _mm_cmpeq_epi16(a, b); }
+static inline ivec_t vh_abs(ivec_t a) { return _mm_abs_epi16(a); }
+
+// lane-wise (a * b) >> 12
+static inline ivec_t vh_mul_q12(ivec_t a, ivec_t b) {
+    return _mm_or_si128(
+        _mm_slli_epi16(_mm_mulhi_epi16(a, b), 4),
+        _mm_srli_epi16(_mm_mullo_epi16(a, b), 12));
+}
+
+// 64bit lanes for double
+static constexpr int BATCH_LANES_64 = 2;
+using dvec_t = __m128d;
+static inline ivec_t vq_set1(int64_t v) { return _mm_set1_epi64x(v); }
+static inline ivec_t vq_sub(ivec_t a, ivec_t b) { return _mm_sub_epi64(a, b); }
+static inline void vq_store(int64_t *p, ivec_t v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline dvec_t vd_load(const double *p) { return _mm_loadu_pd(p); }
+static inline dvec_t vd_set1(double v) { return _mm_set1_pd(v); }
+static inline dvec_t vd_add(dvec_t a, dvec_t b) { return _mm_add_pd(a, b); }
+static inline dvec_t vd_sub(dvec_t a, dvec_t b) { return _mm_sub_pd(a, b); }
+static inline dvec_t vd_mul(dvec_t a, dvec_t b) { return _mm_mul_pd(a, b); }
+static inline ivec_t vd_cmplt(dvec_t a, dvec_t b) { return _mm_castpd_si128(_mm_cmplt_pd(a, b)); }
+static inline ivec_t vd_cmpeq(dvec_t a, dvec_t b) { return _mm_castpd_si128(_mm_cmpeq_pd(a, b)); }
+#endif
+
+// calculate BATCH_LANES points
+// lanes that came back to the snapshot stop as periodic (MANDEL_ENABLE_PERIODICITY_CHECK)
+static inline void mandelbrot_lanes(const elem_t *a_in, const elem_t *b_in, count_t *result, int max_loops) {
+    ivec_t count = vi_set1(0);
+    ivec_t active = vi_set1(-1);
+    ivec_t periodic = vi_set1(0);
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    int check_len = PERIODICITY_CHECK_MIN, check_n = check_len;
+#endif
+#if MANDEL_ENABLE_FIXED_POINT
+    const ivec_t a = vi_load(a_in), b = vi_load(b_in);
+    const ivec_t limit = vi_set1(FIXED(4));
+    ivec_t x = vi_set1(0), y = vi_set1(0);
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    ivec_t px = x, py = y;
+#endif
+    int n = max_loops;
+    do {
+        ivec_t xy = vi_mul_fixed(x, y);
+        ivec_t xx = vi_mul_fixed(x, x);
+        ivec_t yy = vi_mul_fixed(y, y);
+        x = vi_add(vi_sub(xx, yy), a);
+        y = vi_add(vi_add(xy, xy), b);
+        count = vi_sub(count, active);
+        active = vi_and(active, vi_cmplt(vi_add(xx, yy), limit));
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+        periodic = vi_or(periodic, vi_and(active, vi_and(vi_cmpeq(x, px), vi_cmpeq(y, py))));
+        active = vi_andnot(periodic, active);
+        if (--check_n == 0) {
+            check_len <<= 1;
+            check_n = check_len;
+            px = x;
+            py = y;
+        }
+#endif
+    } while (--n != 0 && vi_any(active));
+#else
+    const fvec_t a = vf_load(a_in), b = vf_load(b_in);
+    const fvec_t limit = vf_set1(FIXED(4));
+    fvec_t x = vf_set1(0), y = vf_set1(0);
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    fvec_t px = x, py = y;
+#endif
+    int n = max_loops;
+    do {
+        fvec_t xy = vf_mul(x, y);
+        fvec_t xx = vf_mul(x, x);
+        fvec_t yy = vf_mul(y, y);
+        x = vf_add(vf_sub(xx, yy), a);
+        y = vf_add(vf_add(xy, xy), b);
+        count = vi_sub(count, active);
+        active = vi_and(active, vf_cmplt(vf_add(xx, yy), limit));
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+        periodic = vi_or(periodic, vi_and(active, vi_and(vf_cmpeq(x, px), vf_cmpeq(y, py))));
+        active = vi_andnot(periodic, active);
+        if (--check_n == 0) {
+            check_len <<= 1;
+            check_n = check_len;
+            px = x;
+            py = y;
+        }
+#endif
+    } while (--n != 0 && vi_any(active));
+#endif
+    count = vi_blend(count, vi_set1(max_loops), periodic);
+    int32_t tmp[BATCH_LANES];
+    vi_store(tmp, count);
+    for (int i = 0; i < BATCH_LANES; i++) {
+        result[i] = tmp[i];
+    }
+}
+
+// calculate BATCH_LANES_64 points (double)
+static inline void mandelbrot_lanes_f64(const double *a_in, const double *b_in, count_t *result, int max_loops) {
+    const dvec_t a = vd_load(a_in), b = vd_load(b_in);
+    const dvec_t limit = vd_set1(4);
+    dvec_t x = vd_set1(0), y = vd_set1(0);
+    ivec_t count = vq_set1(0);
+    ivec_t active = vq_set1(-1);
+    ivec_t periodic = vq_set1(0);
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    dvec_t px = x, py = y;
+    int check_len = PERIODICITY_CHECK_MIN, check_n = check_len;
+#endif
+    int n = max_loops;
+    do {
+        dvec_t xy = vd_mul(x, y);
+        dvec_t xx = vd_mul(x, x);
+        dvec_t yy = vd_mul(y, y);
+        x = vd_add(vd_sub(xx, yy), a);
+        y = vd_add(vd_add(xy, xy), b);
+        count = vq_sub(count, active);
+        active = vi_and(active, vd_cmplt(vd_add(xx, yy), limit));
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+        periodic = vi_or(periodic, vi_and(active, vi_and(vd_cmpeq(x, px), vd_cmpeq(y, py))));
+        active = vi_andnot(periodic, active);
+        if (--check_n == 0) {
+            check_len <<= 1;
+            check_n = check_len;
+            px = x;
+            py = y;
+        }
+#endif
+    } while (--n != 0 && vi_any(active));
+    count = vi_blend(count, vq_set1(max_loops), periodic);
+    int64_t tmp[BATCH_LANES_64];
+    vq_store(tmp, count);
+    for (int i = 0; i < BATCH_LANES_64; i++) {
+        result[i] = tmp[i];
+    }
+}
+
+#if MANDEL_ENABLE_FIXED_POINT
+// calculate BATCH_LANES_16 points (Q4.12)
+// |x| >= 2 or |y| >= 2 is checked first so that xx + yy fits in 16bit
+static inline void mandelbrot_lanes_q12(const int16_t *a_in, const int16_t *b_in, count_t *result, int max_loops) {
+    const ivec_t a = vh_load(a_in), b = vh_load(b_in);
+    const ivec_t limit = vh_set1(4 << 12);
+    const ivec_t half_limit = vh_set1(2 << 12);
+    ivec_t x = vh_set1(0), y = vh_set1(0);
+    ivec_t count = vh_set1(0);
+    ivec_t active = vh_set1(-1);
+    ivec_t periodic = vh_set1(0);
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+    ivec_t px = x, py = y;
+    int check_len = PERIODICITY_CHECK_MIN, check_n = check_len;
+#endif
+    int n = max_loops;
+    do {
+        ivec_t in_range = vi_and(vh_cmplt(vh_abs(x), half_limit), vh_cmplt(vh_abs(y), half_limit));
+        ivec_t xy = vh_mul_q12(x, y);
+        ivec_t xx = vh_mul_q12(x, x);
+        ivec_t yy = vh_mul_q12(y, y);
+        x = vh_add(vh_sub(xx, yy), a);
+        y = vh_add(vh_add(xy, xy), b);
+        count = vh_sub(count, active);
+        active = vi_and(active, vi_and(in_range, vh_cmplt(vh_add(xx, yy), limit)));
+#if MANDEL_ENABLE_PERIODICITY_CHECK
+        periodic = vi_or(periodic, vi_and(active, vi_and(vh_cmpeq(x, px), vh_cmpeq(y, py))));
+        active = vi_andnot(periodic, active);
+        if (--check_n == 0) {
+            check_len <<= 1;
+            check_n = check_len;
+            px = x;
+            py = y;
+        }
+#endif
+    } while (--n != 0 && vi_any(active));
+    count = vi_blend(count, vh_set1(max_loops), periodic);
+    int16_t tmp[BATCH_LANES_16];
+    vh_store(tmp, count);
+    for (int i = 0; i < BATCH_LANES_16; i++) {
+        result[i] = tmp[i];
+    }
+}
+#endif
+
+#else
+
+// no SIMD: each lane simply runs the scalar loop
+static constexpr int BATCH_LANES = 4;
+static constexpr int BATCH_LANES_16 = 4;
+static constexpr int BATCH_LANES_64 = 4;
+
+static inline void mandelbrot_lanes(const elem_t *a, const elem_t *b, count_t *result, int max_loops) {
+    for (int i = 0; i < BATCH_LANES; i++) {
+        result[i] = mandelbrot_func(a[i], b[i], max_loops);
+    }
+}
+
+static inline void mandelbrot_lanes_f64(const double *a, const double *b, count_t *result, int max_loops) {
+    for (int i = 0; i < BATCH_LANES_64; i++) {
+        result[i] = mandelbrot_func_f64(a[i], b[i], max_loops);
+    }
+}
+
+#if MANDEL_ENABLE_FIXED_POINT
+static inline void mandelbrot_lanes_q12(const int16_t *a, const int16_t *b, count_t *result, int max_loops) {
+    for (int i = 0; i < BATCH_LANES_16; i++) {
+        result[i] = mandelbrot_func_q12(a[i], b[i], max_loops);
+    }
+}
+#endif
+
+#endif
+
+// calculate num points with LANES_FUNC
+template<typename T, int LANES, void (*LANES_FUNC)(const T *, const T *, count_t *, int)>
+static inline void run_batch(const T *a, const T *b, count_t *result, int num, int max_loops) {
+    int i = 0;
+    for (; i + LANES <= num; i += LANES) {
+        LANES_FUNC(a + i, b + i, result + i, max_loops);
+    }
+    if (i < num) {
+        // fill unused lanes with the last point
+        T a_rest[LANES], b_rest[LANES];
+        count_t result_rest[LANES];
+        for (int j = 0; j < LANES; j++) {
+            int k = (i + j < num) ? (i + j) : (num - 1);
+            a_rest[j] = a[k];
+            b_rest[j] = b[k];
+        }
+        LANES_FUNC(a_rest, b_rest, result_rest, max_loops);
+        for (int j = 0; i + j < num; j++) {
+            result[i + j] = result_rest[j];
+        }
+    }
+}
+
+// calculate num points
+static inline void mandelbrot_batch(const elem_t *a, const elem_t *b, count_t *result, int num, int max_loops) {
+    run_batch<elem_t, BATCH_LANES, mandelbrot_lanes>(a, b, result, num, max_loops);
+}
+
+// calculate num points (double)
+static inline void mandelbrot_batch_f64(const double *a, const double *b, count_t *result, int num, int max_loops) {
+    run_batch<double, BATCH_LANES_64, mandelbrot_lanes_f64>(a, b, result, num, max_loops);
+}
+
+#if MANDEL_ENABLE_FIXED_POINT
+// calculate num points (Q4.12)
+static inline void mandelbrot_batch_q12(const int16_t *a, const int16_t *b, count_t *result, int num, int max_loops) {
+    run_batch<int16_t, BATCH_LANES_16, mandelbrot_lanes_q12>(a, b, result, num, max_loops);
+}
+#endif
+#endif
+
+} // namespace
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef MULTICORE_EXECUTOR_HPP
+#define MULTICORE_EXECUTOR_HPP
+
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "render_executor.hpp"
+
+namespace tinymandelbrot {
+
+// runs render jobs on both cores of RP2040
+// core1 waits for a request via the inter-core FIFO and takes jobs
+// from the same job counter as core0
+class MulticoreExecutor : public RenderExecutor {
+private:
+    inline static MulticoreExecutor *_instance = nullptr;
+
+    spin_lock_t *_lock = nullptr;
+    job_func_t _func = nullptr;
+    void *_context = nullptr;
+    int _num_jobs = 0;
+    volatile int _next_job = 0;
+
+public:
+    // launch core1 (call once)
+    void start() {
+        _instance = this;
+        _lock = spin_lock_init(spin_lock_claim_unused(true));
+        multicore_launch_core1(core1_main);
+    }
+
+    void run(int num_jobs, job_func_t func, void *context) override {
+        if (!_lock) {
+            RenderExecutor::run(num_jobs, func, context);
+            return;
+        }
+
+        _func = func;
+        _context = context;
+        _num_jobs = num_jobs;
+        _next_job = 0;
+        __dmb();
+
+        // wake up core1 and work together
+        multicore_fifo_push_blocking(0);
+        take_jobs();
+
+        // wait for core1
+        multicore_fifo_pop_blocking();
+        __dmb();
+    }
+
+private:
+    int next_job() {
+        uint32_t save = spin_lock_blocking(_lock);
+        int job = _next_job++;
+        spin_unlock(_lock, save);
+        return job;
+    }
+
+    void take_jobs() {
+        int job;
+        while ((job = next_job()) < _num_jobs) {
+            _func(_context, job);
+        }
+    }
+
+    static void core1_main() {
+        while (true) {
+            multicore_fifo_pop_blocking();
+            __dmb();
+            _instance->take_jobs();
+            __dmb();
+            multicore_fifo_push_blocking(0);
+        }
+    }
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PERTURBATION_HPP
+#define PERTURBATION_HPP
+
+#include <stdint.h>
+#include "tiny_mandelbrot_config.hpp"
+#include "mandelbrot_kernel.hpp"
+
+namespace MANDEL_NAMESPACE {
+
+// coord_t to delta_t scale (2^-COORD_POINT_POS)
+static constexpr delta_t COORD_TO_DELTA = (delta_t)1 / (delta_t)((uint64_t)1 << COORD_POINT_POS);
+
+// |Z + delta|^2 < GLITCH_TOLERANCE * |Z|^2 is treated as glitch
+static constexpr delta_t GLITCH_TOLERANCE = (delta_t)1e-4;
+
+// high precision orbit of the reference point
+struct reference_orbit_t {
+    // Z_n
+    delta_t x[MAX_LOOPS];
+    delta_t y[MAX_LOOPS];
+
+    // GLITCH_TOLERANCE * |Z_n|^2
+    delta_t glitch[MAX_LOOPS];
+
+    // number of valid Z_n (the last one is the escaped value)
+    int length = 0;
+
+    // calculate orbit of c = a + bi
+    void compute(coord_t a, coord_t b, int max_loops) {
+        const coord_t two = COORD(2);
+        const coord_t four = COORD(4);
+        coord_t zx = 0, zy = 0;
+        int n = 0;
+        while (n < max_loops) {
+            delta_t fx = (delta_t)zx * COORD_TO_DELTA;
+            delta_t fy = (delta_t)zy * COORD_TO_DELTA;
+            x[n] = fx;
+            y[n] = fy;
+            glitch[n] = (fx * fx + fy * fy) * GLITCH_TOLERANCE;
+            n++;
+
+            // |z| >= 2 (checked before squaring to avoid overflow)
+            if (zx >= two || zx <= -two || zy >= two || zy <= -two) break;
+
+            coord_t xx = mul_coord(zx, zx);
+            coord_t yy = mul_coord(zy, zy);
+            coord_t xy = mul_coord(zx, zy);
+            if (xx + yy >= four) break;
+
+            zx = xx - yy + a;
+            zy = xy + xy + b;
+        }
+        length = n;
+    }
+};
+
+// mandelbrot calculation loop for c = reference + (dca + dcb i)
+// the result is compatible with mandelbrot_func()
+// *glitch is set when the reference orbit cannot represent this point
+static inline count_t perturbation_func(const reference_orbit_t &ref, delta_t dca, delta_t dcb, int max_loops, bool *glitch) {
+    delta_t dx = 0, dy = 0;
+    *glitch = false;
+    for (int n = 0; n < max_loops; n++) {
+        if (n >= ref.length) {
+            // reference escaped earlier than this point
+            *glitch = true;
+            return n + 1;
+        }
+
+        delta_t rx = ref.x[n];
+        delta_t ry = ref.y[n];
+        delta_t zx = rx + dx;
+        delta_t zy = ry + dy;
+        delta_t mag = zx * zx + zy * zy;
+        if (mag >= 4) {
+            return n + 1;
+        }
+        if (mag < ref.glitch[n]) {
+            *glitch = true;
+            return n + 1;
+        }
+
+        // delta' = 2 * Z * delta + delta^2 + dc
+        delta_t ndx = 2 * (rx * dx - ry * dy) + (dx * dx - dy * dy) + dca;
+        delta_t ndy = 2 * (rx * dy + ry * dx + dx * dy) + dcb;
+        dx = ndx;
+        dy = ndy;
+    }
+    return max_loops;
+}
+
+} // namespace
+
+#endif
@@ -1,10 +1,7 @@
+#include <stdio.h>
 #include "picosystem.hpp"
 #include "tiny_mandelbrot.hpp"
-
-#define BENCHMARK_A (0xffd8849c)
-#define BENCHMARK_B (0xfef822ee)
-#define BENCHMARK_ZOOM (18)
-#define SKIP_STABLE_RECT (1)
+#include "multicore_executor.hpp"
 
 using namespace picosystem;
 
@@ -12,29 +9,37 @@ static constexpr int W = tinymandelbrot::W;
 static constexpr int H = tinymandelbrot::H;
 
 tinymandelbrot::TinyMandelbrot mandel;
+tinymandelbrot::MulticoreExecutor multicore;
+
+// time per zoom level while A or B is held (ms)
+static constexpr int ZOOM_STEP_TIME = 60;
 
-enum state_t {
-    SCROLL,
-    ZOOM,
-};
+// time for mandelbrot rendering per frame (us)
+static constexpr uint32_t RENDER_BUDGET_US = 15000;
 
-state_t state = SCROLL;
+// render statistics overlay at the top of the screen (toggled by X)
+static constexpr int STATS_LINES = 4;
+static constexpr int STATS_LINE_HEIGHT = 8;
+static constexpr int STATS_HEIGHT = STATS_LINES * STATS_LINE_HEIGHT;
 
-// zoom animation time (ms)
-static constexpr int ZOOM_TIME = 100;
+// characters per line of the overlay (6 pixels per character of the default font)
+// longer lines are cut at the right edge of the screen
+static constexpr int STATS_CHARS = (W - 2) / 6;
 
 struct scroll_state_t {
     int dx = 0;
     int dy = 0;
+    int dz = 0;
+    // direction of the last scroll (guard band is calculated on this side first)
+    int hint_dx = 0;
+    int hint_dy = 0;
     float update_step_accum = 0;
+    int zoom_time_accum = 0;
+    bool show_stats = false;
+    // the overlay is on the frame buffer and has to be erased before scrolling
+    bool stats_drawn = false;
 } scroll;
 
-struct zoom_state_t {
-    uint32_t t_zoom_end_ms;
-    bool is_zoom_in;
-    buffer_t *buff;
-} zoom;
-
 // color palette
 static constexpr int MANDEL_PALETTE_SIZE = 256;
 color_t mandel_palette[MANDEL_PALETTE_SIZE];
@@ -42,14 +47,16 @@ color_t mandel_palette[MANDEL_PALETTE_SIZE];
 void scroll_start(uint32_t now);
 void scroll_update(uint32_t now, int delta_time);
 void scroll_draw();
-
-void zoom_start(uint32_t now, bool zoom_in);
-void zoom_update(uint32_t now, int delta_time);
-void zoom_draw();
+void draw_dirty(Buffer2D<color_t> &frame_buff);
+void draw_span(Buffer2D<color_t> &frame_buff, int y, int x0, int x1);
+void draw_stats(Buffer2D<color_t> &frame_buff);
+void erase_stats(Buffer2D<color_t> &frame_buff);
 
 void init() {
-    // zoom animation buffer
-    zoom.buff = buffer(W/2, H/2);
+    // render on both cores
+    multicore.start();
+    mandel.set_executor(&multicore);
+    mandel.set_clock(time_us);
 
     // generate color palette
     for (int i = 0; i < 256; i++) {
@@ -73,32 +80,21 @@ void update(uint32_t tick) {
     int delta_time = now - last_time;
     last_time = now;
 
-    switch (state) {
-    case state_t::SCROLL:
-        scroll_update(now, delta_time);
-        break;
-    case state_t::ZOOM:
-        zoom_update(now, delta_time);
-        break;
-    }
+    scroll_update(now, delta_time);
 }
 
 void draw(uint32_t tick) {
-    switch (state) {
-    case state_t::SCROLL:
-        scroll_draw();
-        break;
-    case state_t::ZOOM:
-        zoom_draw();
-        break;
-    }
+    scroll_draw();
 }
 
 void scroll_start(uint32_t now) {
     scroll.dx = 0;
     scroll.dy = 0;
+    scroll.dz = 0;
+    scroll.hint_dx = 0;
+    scroll.hint_dy = 0;
     scroll.update_step_accum = 0;
-    state = state_t::SCROLL;
+    scroll.zoom_time_accum = 0;
 }
 
 void scroll_update(uint32_t now, int delta_time) {
@@ -112,8 +108,23 @@ void scroll_update(uint32_t now, int delta_time) {
     if (button(RIGHT)) scroll.dx += step;
     if (button(UP   )) scroll.dy -= step;
     if (button(DOWN )) scroll.dy += step;
-    if (pressed(A)) zoom_start(now, true);
-    if (pressed(B)) zoom_start(now, false);
+
+    // one zoom level on press, then one per ZOOM_STEP_TIME while held
+    if (pressed(A) || pressed(B)) {
+        scroll.zoom_time_accum = ZOOM_STEP_TIME;
+    }
+    if (button(A) || button(B)) {
+        scroll.zoom_time_accum += delta_time;
+        while (scroll.zoom_time_accum >= ZOOM_STEP_TIME) {
+            scroll.zoom_time_accum -= ZOOM_STEP_TIME;
+            if (button(A)) scroll.dz++;
+            if (button(B)) scroll.dz--;
+        }
+    }
+
+    if (pressed(X)) {
+        scroll.show_stats = !scroll.show_stats;
+    }
 
     if (pressed(Y)) {
         mandel.set_zoom(BENCHMARK_ZOOM);
@@ -125,64 +136,65 @@ void scroll_update(uint32_t now, int delta_time) {
 void scroll_draw() {
     Buffer2D<color_t> frame_buff(W, H, W, SCREEN->data);
 
-    if (scroll.dx == 0 && scroll.dy == 0 && mandel.no_change()) {
+    if (scroll.show_stats != scroll.stats_drawn) {
+        if (scroll.show_stats) {
+            draw_stats(frame_buff);
+        }
+        else {
+            erase_stats(frame_buff);
+        }
+    }
+
+    if (scroll.dx == 0 && scroll.dy == 0 && scroll.dz == 0 && mandel.no_change()) {
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_GUARD_BAND
+        // idle: prepare the pixels around the screen for the next scroll
+        mandel.render_guard(scroll.hint_dx, scroll.hint_dy, RENDER_BUDGET_US);
+#endif
         return ;
     }
 
     auto t_start = time_us();
 
-    // scroll mandelbrot buffer
-    mandel.scroll(scroll.dx, scroll.dy);
+    erase_stats(frame_buff);
 
-    // get stable area for fast scroll
-    auto stable_rect = mandel.stable_rect();
-    
-    // update mandelbrot buffer
-    mandel.render();
+    if (scroll.dx != 0 || scroll.dy != 0) {
+        scroll.hint_dx = scroll.dx;
+        scroll.hint_dy = scroll.dy;
+    }
 
-    // scroll frame buffer
+    // scroll mandelbrot buffer and frame buffer
+    mandel.scroll(scroll.dx, scroll.dy);
     frame_buff.scroll(-scroll.dx, -scroll.dy);
 
-    // update frame buffer
-    int stable_x0 = stable_rect.x;
-    int stable_y0 = stable_rect.y;
-    int stable_y1 = stable_rect.b();
-    for (int y = 0; y < H; y++) {
-        auto *rd_ptr = mandel.buff.ptr(0, y);
-        auto *wr_ptr = frame_buff.ptr(0, y);
-        for (int x = 0; x < W; x++) {
-            auto n = *(rd_ptr++);
-            if (n >= tinymandelbrot::MAX_LOOPS + 2) {
-                *(wr_ptr++) = rgb(0, 0, 0);
-            }
-            else {
-                *(wr_ptr++) = mandel_palette[n % MANDEL_PALETTE_SIZE];
-            }
-
-#if SKIP_STABLE_RECT
-            if (stable_y0 <= y && y < stable_y1 && x == stable_x0) {
-                // skip the that already rendered
-                int stride = stable_rect.w - 1;
-                x += stride;
-                rd_ptr += stride;
-                wr_ptr += stride;
-            }
-#endif
-        }
+    if (scroll.dz != 0) {
+        // the previous image resampled to the new zoom level stays on the screen
+        // until the pixels are recalculated
+        mandel.set_zoom_level(mandel.zoom_level() + scroll.dz);
+        draw_dirty(frame_buff);
     }
 
+    // update mandelbrot buffer (continues in the next frame when time is up)
+    mandel.render(RENDER_BUDGET_US);
+
+    draw_dirty(frame_buff);
+
     scroll.dx = 0;
     scroll.dy = 0;
+    scroll.dz = 0;
 
     auto t_elapsed = time_us() - t_start;
 
-#if 0
-    pen(rgb(0, 0, 0));
-    char buff[32];
-    sprintf(buff, "%.3f ms", (float)t_elapsed / 1000);
-    text(buff, 5, 5);
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_GUARD_BAND
+    // the rest of the budget goes to the guard band once the screen is complete
+    if (mandel.no_change() && t_elapsed < RENDER_BUDGET_US) {
+        mandel.render_guard(scroll.hint_dx, scroll.hint_dy, RENDER_BUDGET_US - t_elapsed);
+    }
 #endif
 
+    if (scroll.show_stats) {
+        draw_stats(frame_buff);
+    }
+
 #if 0
     pen(rgb(0, 0, 0));
     frect(0, H - 10, W, 10);
@@ -196,62 +208,68 @@ void scroll_draw() {
 #endif
 }
 
-// start zoom animation
-void zoom_start(uint32_t now, bool zoom_in) {
-    if (zoom_in && mandel.zoom_in()) {
-        zoom.is_zoom_in = true;
-        zoom.t_zoom_end_ms = now + ZOOM_TIME;
-        state = state_t::ZOOM;
-        // store frame buffer image for animation
-        for (int y = 0; y < H / 2; y++) {
-            auto *rd_ptr = SCREEN->p(W / 4, y + H / 4);
-            auto *wr_ptr = zoom.buff->p(0, y);
-            for (int x = 0; x < W / 2; x++) {
-                *(wr_ptr++) = *(rd_ptr++);
+// update frame buffer only where the mandelbrot buffer has changed
+void draw_dirty(Buffer2D<color_t> &frame_buff) {
+    mandel.for_each_dirty_span([&](int y, int x0, int x1) {
+        draw_span(frame_buff, y, x0, x1);
+    });
+    mandel.clear_dirty();
+}
+
+// colorize pixels x0 to (x1 - 1) in the row y (pixels not calculated yet are skipped)
+void draw_span(Buffer2D<color_t> &frame_buff, int y, int x0, int x1) {
+    int max_loops = mandel.max_loops();
+    // the mandelbrot buffer wraps around: a span may consist of two parts
+    mandel.buff.for_each_segment(y, x0, x1, [&](const tinymandelbrot::count_t *rd_ptr, int16_t x, int16_t n) {
+        auto *wr_ptr = frame_buff.ptr(x, y);
+        for (int i = 0; i < n; i++) {
+            auto c = *(rd_ptr++);
+            if (c == 0) {
+                // not calculated yet
+                wr_ptr++;
             }
-        }
-    }
-    else if (!zoom_in && mandel.zoom_out()) {
-        zoom.is_zoom_in = false;
-        zoom.t_zoom_end_ms = now + ZOOM_TIME;
-        state = state_t::ZOOM;
-        // store frame buffer image for animation
-        for (int y = 0; y < H / 2; y++) {
-            auto *rd_ptr = SCREEN->p(0, y * 2);
-            auto *wr_ptr = zoom.buff->p(0, y);
-            for (int x = 0; x < W / 2; x++) {
-                *(wr_ptr++) = *rd_ptr;
-                rd_ptr += 2;
+            else if (c >= max_loops) {
+                *(wr_ptr++) = rgb(0, 0, 0);
+            }
+            else {
+                *(wr_ptr++) = mandel_palette[c % MANDEL_PALETTE_SIZE];
             }
         }
-    }
+    });
 }
 
-// update zoom animation
-void zoom_update(uint32_t now, int delta_time) {
-    if (now > zoom.t_zoom_end_ms + delta_time) {
-        // zoom animation finished
-        scroll_start(now);
-    }
-}
+// statistics of the last frame over the top of the screen
+void draw_stats(Buffer2D<color_t> &frame_buff) {
+    auto &s = mandel.frame_stats();
+    char buff[STATS_LINES][STATS_CHARS + 1];
+
+    // times in 0.1ms (integer formatting keeps the float printf out of the image)
+    unsigned total = s.total_us / 100, scan = s.scan_us / 100, fill = s.fill_us / 100;
+    snprintf(buff[0], sizeof(buff[0]), "z%d %u.%ums/%u scan %u.%u fill %u.%u",
+        mandel.zoom(), total / 10, total % 10, (unsigned)s.calls,
+        scan / 10, scan % 10, fill / 10, fill % 10);
+    snprintf(buff[1], sizeof(buff[1]), "calc %u in %u fill %u",
+        (unsigned)s.pixels, (unsigned)s.interior, (unsigned)s.filled);
+    snprintf(buff[2], sizeof(buff[2]), "cache %u reuse %u q%u o%u",
+        (unsigned)s.cached, (unsigned)s.reused, (unsigned)s.queue_peak, (unsigned)s.overflows);
+    snprintf(buff[3], sizeof(buff[3]), "loops %uk max %u/%d",
+        (unsigned)(s.loops / 1000), (unsigned)s.max_escaped, mandel.max_loops());
 
-// render zoom animation
-void zoom_draw() {
-    int p = zoom.t_zoom_end_ms - time();
-    if (p < 0) {
-        p = 0;
-    }
-    else if (p > ZOOM_TIME) {
-        p = ZOOM_TIME;
+    pen(rgb(0, 0, 0));
+    frect(0, 0, W, STATS_HEIGHT);
+    pen(rgb(15, 15, 15));
+    for (int i = 0; i < STATS_LINES; i++) {
+        text(buff[i], 1, i * STATS_LINE_HEIGHT + 1);
     }
+    scroll.stats_drawn = true;
+}
 
-    if (zoom.is_zoom_in) {
-        p = ZOOM_TIME - p;
+// restore the pixels under the statistics
+void erase_stats(Buffer2D<color_t> &frame_buff) {
+    if (!scroll.stats_drawn) return;
+    frame_buff.fill(rect_t(0, 0, W, STATS_HEIGHT), rgb(0, 0, 0));
+    for (int y = 0; y < STATS_HEIGHT; y++) {
+        draw_span(frame_buff, y, 0, W);
     }
-
-    int dw = (W / 2) + (W / 2) * p / ZOOM_TIME;
-    int dh = (H / 2) + (H / 2) * p / ZOOM_TIME;
-    int dx = (W - dw) / 2;
-    int dy = (H - dw) / 2;
-    blit(zoom.buff, 0, 0, zoom.buff->w, zoom.buff->h, dx, dy, dw, dh);
+    scroll.stats_drawn = false;
 }
@@ -0,0 +1,25 @@
+#ifndef RENDER_EXECUTOR_HPP
+#define RENDER_EXECUTOR_HPP
+
+namespace tinymandelbrot {
+
+// render job: called with job index 0 .. num_jobs-1
+using job_func_t = void (*)(void *context, int job);
+
+// executes render jobs
+// default implementation runs all jobs in the caller's thread
+class RenderExecutor {
+public:
+    virtual ~RenderExecutor() { }
+
+    // run all jobs and wait for completion
+    virtual void run(int num_jobs, job_func_t func, void *context) {
+        for (int i = 0; i < num_jobs; i++) {
+            func(context, i);
+        }
+    }
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef SCANLINE_QUEUE_HPP
+#define SCANLINE_QUEUE_HPP
+
+#include <stdint.h>
+#include "buffer2d_utils.hpp"
+
+// pixel work list bucketed by row
+// pop() sweeps the rows from top to bottom (and wraps around) so that
+// pixels close to each other are taken together
+class ScanlineQueue {
+public:
+    // the row of the node is given by the list that holds it
+    struct node_t {
+        int16_t x;
+        int16_t next;
+    };
+
+private:
+    node_t *_nodes;
+    int16_t *_heads;
+    int16_t _free;
+    int _size;
+    int _peak;
+    int _y0;
+    int _rows;
+    int _cursor;
+    bool _destroy;
+
+public:
+    const int CAPACITY;
+    const int MAX_ROWS;
+
+    // nodes, heads: (1 << capacity_bits) nodes and max_rows heads owned by the caller
+    // (nullptr: allocated here)
+    ScanlineQueue(int capacity_bits, int max_rows, node_t *nodes = nullptr, int16_t *heads = nullptr) :
+        _nodes(nodes ? nodes : new node_t[1 << capacity_bits]),
+        _heads(heads ? heads : new int16_t[max_rows]),
+        _destroy(nodes == nullptr),
+        CAPACITY(1 << capacity_bits),
+        MAX_ROWS(max_rows) {
+        reset(0, max_rows);
+    }
+
+    ~ScanlineQueue() {
+        if (_destroy) {
+            delete[] _nodes;
+            delete[] _heads;
+        }
+    }
+
+    // empty the queue and accept rows y0 to (y0 + rows - 1)
+    void reset(int y0, int rows) {
+        if (rows > MAX_ROWS) rows = MAX_ROWS;
+        _y0 = y0;
+        _rows = rows;
+        _cursor = 0;
+        _size = 0;
+        _peak = 0;
+        for (int i = 0; i < _rows; i++) {
+            _heads[i] = -1;
+        }
+        for (int i = 0; i < CAPACITY; i++) {
+            _nodes[i].next = (i + 1 < CAPACITY) ? i + 1 : -1;
+        }
+        _free = 0;
+    }
+
+    int size() const { return _size; }
+    bool empty() const { return _size <= 0; }
+    bool full() const { return _size >= CAPACITY; }
+
+    // max size since the last reset()
+    int peak() const { return _peak; }
+
+    bool push(pos_t pos) {
+        int row = pos.y - _y0;
+        if (full() || row < 0 || row >= _rows) return false;
+        int16_t i = _free;
+        _free = _nodes[i].next;
+        _nodes[i].x = pos.x;
+        _nodes[i].next = _heads[row];
+        _heads[row] = i;
+        if (++_size > _peak) _peak = _size;
+        return true;
+    }
+
+    bool pop(pos_t *value) {
+        if (empty()) return false;
+        while (_heads[_cursor] < 0) {
+            if (++_cursor >= _rows) _cursor = 0;
+        }
+        int16_t i = _heads[_cursor];
+        _heads[_cursor] = _nodes[i].next;
+        *value = pos_t(_nodes[i].x, _y0 + _cursor);
+        _nodes[i].next = _free;
+        _free = i;
+        _size--;
+        return true;
+    }
+
+    pos_t pop() {
+        pos_t value;
+        pop(&value);
+        return value;
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef TILE_CACHE_HPP
+#define TILE_CACHE_HPP
+
+#include <stdint.h>
+#include "tiny_mandelbrot_config.hpp"
+
+namespace MANDEL_NAMESPACE {
+
+// LRU cache of calculated pixels
+// a cache tile is a square of (1 << CACHE_TILE_BITS) pixels aligned to the
+// pixel grid of its zoom level, calculated with the iteration limit `loops`
+// entries are grouped into sets of WAYS entries selected by the key hash
+class TileCache {
+public:
+    static constexpr int SIZE = 1 << CACHE_TILE_BITS;
+    static constexpr int WAYS = 4;
+
+    struct entry_t {
+        bool valid = false;
+        int zoom = 0;
+        int loops = 0;
+        int64_t tx = 0, ty = 0;
+        uint32_t last_used = 0;
+        count_t data[SIZE * SIZE];
+    };
+
+private:
+    entry_t *_entries;
+    uint32_t _time;
+    bool _destroy;
+
+public:
+    const int CAPACITY;
+    const int NUM_SETS;
+
+    // storage: capacity entries owned by the caller (nullptr: allocated here)
+    TileCache(int capacity, entry_t *storage = nullptr) :
+        _entries(storage ? storage : new entry_t[capacity]),
+        _time(0),
+        _destroy(storage == nullptr),
+        CAPACITY(capacity),
+        NUM_SETS(capacity / WAYS) { }
+
+    ~TileCache() {
+        if (_destroy) {
+            delete[] _entries;
+        }
+    }
+
+    void clear() {
+        for (int i = 0; i < CAPACITY; i++) {
+            _entries[i].valid = false;
+        }
+    }
+
+    // pixels of the tile, or nullptr if not cached
+    const count_t *find(int zoom, int loops, int64_t tx, int64_t ty) {
+        auto *set = find_set(zoom, tx, ty);
+        for (int i = 0; i < WAYS; i++) {
+            auto &e = set[i];
+            if (e.valid && e.zoom == zoom && e.loops == loops && e.tx == tx && e.ty == ty) {
+                e.last_used = ++_time;
+                return e.data;
+            }
+        }
+        return nullptr;
+    }
+
+    // buffer to store pixels of the tile (replaces the least recently used one in the set)
+    count_t *insert(int zoom, int loops, int64_t tx, int64_t ty) {
+        auto *set = find_set(zoom, tx, ty);
+        entry_t *victim = &set[0];
+        for (int i = 0; i < WAYS; i++) {
+            auto &e = set[i];
+            if (e.valid && e.zoom == zoom && e.tx == tx && e.ty == ty) {
+                victim = &e;
+                break;
+            }
+            if (!e.valid) {
+                if (victim->valid) victim = &e;
+            }
+            else if (victim->valid && e.last_used < victim->last_used) {
+                victim = &e;
+            }
+        }
+        victim->valid = true;
+        victim->zoom = zoom;
+        victim->loops = loops;
+        victim->tx = tx;
+        victim->ty = ty;
+        victim->last_used = ++_time;
+        return victim->data;
+    }
+
+private:
+    entry_t *find_set(int zoom, int64_t tx, int64_t ty) const {
+        uint64_t h = (uint64_t)tx * 0x9e3779b97f4a7c15ull;
+        h ^= (uint64_t)ty * 0xc2b2ae3d27d4eb4full;
+        h ^= (uint64_t)zoom * 0x165667b19e3779f9ull;
+        h ^= h >> 29;
+        return &_entries[(h % NUM_SETS) * WAYS];
+    }
+};
+
+} // namespace
+
+#endif
@@ -2,21 +2,25 @@
 #define TINY_MANDELBROT_HPP
 
 #include <stdint.h>
+#include <math.h>
 #include "tiny_mandelbrot_config.hpp"
-#include "array_queue.hpp"
+#include "mandelbrot_kernel.hpp"
+#include "array_stack.hpp"
+#include "scanline_queue.hpp"
 #include "buffer2d_utils.hpp"
+#include "render_executor.hpp"
+#if MANDEL_ENABLE_DEEP_ZOOM
+#include "perturbation.hpp"
+#endif
+#if MANDEL_ENABLE_TILE_CACHE
+#include "tile_cache.hpp"
+#endif
 
-namespace tinymandelbrot {
+namespace MANDEL_NAMESPACE {
 
-// generate fixed point value
-#if MANDEL_ENABLE_FIXED_POINT
-static inline elem_t FIXED(int val) { return ((elem_t)val) << FIXED_POINT_POS; }
-static inline elem_t FIXED(float val) { return (elem_t)(val * FIXED(1)); }
-static inline elem_t FIXED(double val) { return (elem_t)(val * FIXED(1)); }
-#else
-template<typename T>
-static inline elem_t FIXED(T val) { return (elem_t)val; }
-#endif
+// the executors are shared by all configurations
+using tinymandelbrot::job_func_t;
+using tinymandelbrot::RenderExecutor;
 
 template<typename T>
 T limit(T min, T max, T value) {
@@ -25,232 +29,1855 @@ T limit(T min, T max, T value) {
     return value;
 }
 
-static count_t mandelbrot_func(elem_t a, elem_t b);
+// statistics of the last render() call, or of a frame (frame_stats())
+struct render_stats_t {
+    // number of pixels calculated by mandelbrot_func
+    uint32_t pixels = 0;
+
+    // total loop count of mandelbrot_func
+    uint32_t loops = 0;
+
+    // number of reference orbits made for glitched pixels
+    uint32_t refs = 0;
+
+    // number of pixels restored from the tile cache
+    uint32_t cached = 0;
+
+    // max number of queued pixels in a tile (MANDEL_SCAN_BORDER)
+    uint32_t queue_peak = 0;
+
+    // number of pixels that did not fit in the queue and were rescanned later
+    uint32_t overflows = 0;
+
+    // number of calculated pixels that escaped within the iteration limit
+    uint32_t escaped = 0;
+
+    // number of escaped pixels in the last quarter of the iteration limit
+    uint32_t escaped_high = 0;
+
+    // max escape count
+    uint32_t max_escaped = 0;
+
+    // number of pixels filled with the value of the neighbors without calculation
+    uint32_t filled = 0;
+
+    // number of pixels found in the main cardioid or the period-2 bulb without iteration
+    // (MANDEL_ENABLE_INTERIOR_CHECK, not included in pixels)
+    uint32_t interior = 0;
+
+    // number of pixels kept from the previous frame by scrolling or zoom reuse
+    // (frame_stats() of a completed frame only)
+    uint32_t reused = 0;
+
+    // time spent in the scan loop and in the fill pass of the tiles
+    // (us, summed over the tiles, needs set_clock())
+    uint32_t scan_us = 0;
+    uint32_t fill_us = 0;
+
+    // elapsed time of render() (us, needs set_clock())
+    uint32_t total_us = 0;
+
+    // number of render() calls
+    uint32_t calls = 0;
+
+    void clear() { *this = render_stats_t(); }
+
+    void count(count_t n, int max_loops) {
+        pixels++;
+        loops += n;
+        if (n < max_loops) {
+            escaped++;
+            if (n * 4 >= max_loops * 3) escaped_high++;
+            if (n > max_escaped) max_escaped = n;
+        }
+    }
+
+    void add(const render_stats_t &other) {
+        pixels += other.pixels;
+        loops += other.loops;
+        refs += other.refs;
+        cached += other.cached;
+        if (other.queue_peak > queue_peak) queue_peak = other.queue_peak;
+        overflows += other.overflows;
+        escaped += other.escaped;
+        escaped_high += other.escaped_high;
+        if (other.max_escaped > max_escaped) max_escaped = other.max_escaped;
+        filled += other.filled;
+        interior += other.interior;
+        reused += other.reused;
+        scan_us += other.scan_us;
+        fill_us += other.fill_us;
+        total_us += other.total_us;
+        calls += other.calls;
+    }
+};
+
+// current time in microseconds
+using clock_func_t = uint32_t (*)();
+
+// render task for a part of the screen
+struct tile_t {
+    rect_t rect;
+    render_stats_t stats;
+
+    // progress of the current frame
+    bool started = false;
+    bool done = false;
+
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+#if MANDEL_ENABLE_STATIC_STORAGE
+    ScanlineQueue::node_t queue_nodes[1 << QUEUE_SIZE_BITS];
+    int16_t queue_heads[H];
+#endif
+
+    // pixels to calculate
+    ScanlineQueue queue;
+
+    // rows to rescan for pixels dropped from the full queue
+    int overflow_y0 = 0;
+    int overflow_y1 = 0;
+
+    // next pixel to look for edges between reused pixels
+    // (MANDEL_ENABLE_ZOOM_REUSE, MANDEL_ENABLE_PROGRESSIVE)
+    int lattice_pos = 0;
+#elif MANDEL_SCAN_MODE == MANDEL_SCAN_RECT
+#if MANDEL_ENABLE_STATIC_STORAGE
+    rect_t rect_storage[RECT_STACK_SIZE];
+#endif
+
+    // rectangles to subdivide
+    ArrayStack<rect_t> rects;
+#else
+    // next row to calculate
+    int next_y = 0;
+#endif
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+    // reference orbits for glitched pixels
+    reference_orbit_t refs[MAX_REFERENCES - 1];
+    pos_t ref_pos[MAX_REFERENCES - 1];
+    int num_refs = 0;
+    int next_ref = 0;
+#endif
+
+#if MANDEL_ENABLE_STATIC_STORAGE
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+    tile_t() : queue(QUEUE_SIZE_BITS, H, queue_nodes, queue_heads) { }
+#elif MANDEL_SCAN_MODE == MANDEL_SCAN_RECT
+    tile_t() : rects(RECT_STACK_SIZE, rect_storage) { }
+#endif
+#else
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+    tile_t() : queue(QUEUE_SIZE_BITS, H) { }
+#elif MANDEL_SCAN_MODE == MANDEL_SCAN_RECT
+    tile_t() : rects(RECT_STACK_SIZE) { }
+#endif
+#endif
+};
 
 class TinyMandelbrot {
+#if MANDEL_ENABLE_STATIC_STORAGE
+private:
+    // storage of the buffers below (declared first so that it outlives them)
+    count_t _buff_data[W * H];
+
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER || MANDEL_ENABLE_PROGRESSIVE
+    // the coarse passes end before the scan of the frame starts and the scan flags are clear
+    // by then, so _coarse shares the words with _queued
+    uint32_t _flag_words[Bitmap2D::words(W, H)];
+#endif
+
+#if MANDEL_ENABLE_TILE_CACHE
+    TileCache::entry_t _cache_entries[CACHE_TILES];
+#endif
+#endif
+
 public:
     Buffer2D<count_t> buff;
-    ArrayQueue<pos_t> queue;
+    render_stats_t stats;
 
 private:
-    elem_t _a, _b;
+    coord_t _a, _b;
     int _zoom;
+
+    // fractional part of the zoom level (0 to ZOOM_SUBSTEPS - 1)
+    int _zoom_sub;
+
+    // a, b distance between adjacent pixels
+    coord_t _pixel_size;
+
     rect_t _stable_rect;
 
+    // iteration limit of the pixels in the buffer
+    int _max_loops;
+
+    // iteration limit requested for the next frame
+    int _loops_target;
+
+    // statistics of the current frame
+    render_stats_t _frame_stats;
+
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+    // pixels pushed to the queue of the tile
+    Bitmap2D _queued;
+
+    // pixels to recalculate after the iteration limit was raised are marked as queued
+    bool _rescan_stale;
+#endif
+
+    // span of pixels in each row that got new values since the last clear_dirty()
+    // (empty when x0 >= x1)
+    int16_t _dirty_x0[H], _dirty_x1[H];
+
+    tile_t _tiles[RENDER_TILES];
+    RenderExecutor _default_executor;
+    RenderExecutor *_executor;
+
+    // time limit of render()
+    clock_func_t _clock;
+    bool _time_limited;
+    uint32_t _deadline_us;
+
+    // a frame is in progress
+    bool _rendering;
+
+#if MANDEL_ENABLE_ZOOM_REUSE || MANDEL_ENABLE_PROGRESSIVE
+    // pixels on the even global grid are known
+    // (reused from the previous zoom level or calculated by the coarse passes)
+    bool _lattice_seed;
+#endif
+
+#if MANDEL_ENABLE_PROGRESSIVE
+    // lattice step of the next coarse pass
+    // (1: the previews are left to drop, 0: no coarse pass left in the frame)
+    int _coarse_step;
+
+    // the tile jobs fill the blocks (otherwise calculate the lattice points)
+    bool _coarse_fill;
+
+    // pixels holding the value of their block until calculated
+    Bitmap2D _coarse;
+#endif
+
+#if MANDEL_ENABLE_ZOOM_REUSE
+    // pixels holding values resampled from the previous zoom level
+    // (shown until the next frame starts, then recalculated)
+    enum preview_t {
+        PREVIEW_NONE,
+        PREVIEW_UNSTABLE, // pixels outside the stable rect
+        PREVIEW_LATTICE,  // pixels off the even global grid
+    };
+    preview_t _preview;
+#endif
+
+#if MANDEL_ENABLE_TILE_CACHE
+    static constexpr int MAX_RESTORED = ((W >> CACHE_TILE_BITS) + 2) * ((H >> CACHE_TILE_BITS) + 2);
+
+    TileCache _cache;
+
+    // global pixel position of buff[0, 0] in the current frame
+    int64_t _x_origin, _y_origin;
+
+    // stable rect at the start of the current frame
+    rect_t _frame_stable_rect;
+
+    // areas restored from the cache in the current frame
+    rect_t _restored[MAX_RESTORED];
+    int _num_restored;
+
+#if MANDEL_ENABLE_GUARD_BAND
+    // cache tile calculated by a render job of render_guard()
+    struct guard_job_t {
+        int64_t tx, ty;
+        bool done;
+        count_t data[TileCache::SIZE * TileCache::SIZE];
+    };
+    guard_job_t _guard_jobs[RENDER_TILES];
+
+    // all tiles of the band are cached for the current view and direction
+    bool _guard_complete;
+    int _guard_dx, _guard_dy;
+
+    // tiles calculated for the current view and direction
+    // (stops recalculating tiles evicted by the other tiles of the band)
+    int _guard_tiles;
+#endif
+#endif
+
+    // pixel position parameters of the current render()
+    coord_t _coord_step, _a_coord_offset, _b_coord_offset;
+    precision_t _precision;
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+    // reference orbit at the view center
+    reference_orbit_t _ref;
+    delta_t _delta_step;
+#endif
+
 public:
     TinyMandelbrot() : 
-        buff(W, H), 
-        queue(QUEUE_SIZE_BITS),
-        _a(FIXED(-0.5)),
+#if MANDEL_ENABLE_STATIC_STORAGE
+        buff(W, H, W, _buff_data, false, MANDEL_ENABLE_WRAP_BUFFER),
+#else
+        buff(W, H, MANDEL_ENABLE_WRAP_BUFFER), 
+#endif
+        _a(COORD(-0.5)),
         _b(0),
-        _zoom(0)
+        _zoom(0),
+        _zoom_sub(0),
+        _pixel_size(level_pixel_size(0, 0)),
+        _max_loops(DEFAULT_LOOPS),
+        _loops_target(DEFAULT_LOOPS),
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER && MANDEL_ENABLE_STATIC_STORAGE
+        _queued(W, H, _flag_words),
+        _rescan_stale(false),
+#elif MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+        _queued(W, H),
+        _rescan_stale(false),
+#endif
+        _executor(&_default_executor),
+        _clock(nullptr),
+        _time_limited(false),
+        _deadline_us(0),
+        _rendering(false)
+#if MANDEL_ENABLE_ZOOM_REUSE || MANDEL_ENABLE_PROGRESSIVE
+        , _lattice_seed(false)
+#endif
+#if MANDEL_ENABLE_PROGRESSIVE
+        , _coarse_step(0),
+        _coarse_fill(false),
+#if MANDEL_ENABLE_STATIC_STORAGE
+        _coarse(W, H, _flag_words)
+#else
+        _coarse(W, H)
+#endif
+#endif
+#if MANDEL_ENABLE_ZOOM_REUSE
+        , _preview(PREVIEW_NONE)
+#endif
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_STATIC_STORAGE
+        , _cache(CACHE_TILES, _cache_entries),
+        _num_restored(0)
+#elif MANDEL_ENABLE_TILE_CACHE
+        , _cache(CACHE_TILES),
+        _num_restored(0)
+#endif
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_GUARD_BAND
+        , _guard_complete(false),
+        _guard_dx(0),
+        _guard_dy(0),
+        _guard_tiles(0)
+#endif
     {
         buff.fill();
+        clear_dirty();
     }
 
-    elem_t a() const { return _a; }
-    elem_t b() const { return _b; }
+    elem_t a() const { return coord_to_elem(_a); }
+    elem_t b() const { return coord_to_elem(_b); }
     void set_pos(elem_t a, elem_t b) {
+        set_pos_coord(elem_to_coord(a), elem_to_coord(b));
+    }
+
+    coord_t a_coord() const { return _a; }
+    coord_t b_coord() const { return _b; }
+    void set_pos_coord(coord_t a, coord_t b) {
         auto a_px = a_pixel();
         auto b_px = b_pixel();
 
-        const elem_t range = FIXED(2);
-        a = round_elem(a);
-        b = round_elem(b);
-        a = limit(-range, range, a);
-        b = limit(-range, range, b);
+        const coord_t range = COORD(VIEW_RANGE);
+        a = round_coord(limit(-range, range, a));
+        b = round_coord(limit(-range, range, b));
 
         if (a == _a && b == _b) return;
 
+        cancel_render();
         _a = a;
         _b = b;
 
 #if MANDEL_ENABLE_FAST_SCROLL
-        if (!_stable_rect.empty()) {
-            auto dx = a_pixel() - a_px;
-            auto dy = b_pixel() - b_px;
-            if (-W < dx && dx < W && -H < dy && dy < H) {
-                buff.scroll(-dx, -dy);
-                if (dx > 0) {
-                    buff.fill(rect_t(W - dx, 0, dx, H));
-                }
-                else if (dx < 0) {
-                    buff.fill(rect_t(0, 0, -dx, H));
-                }
-                if (dy > 0) {
-                    buff.fill(rect_t(0, H - dy, W, dy));
-                }
-                else if (dy < 0) {
-                    buff.fill(rect_t(0, 0, W, -dy));
-                }
-                _stable_rect = _stable_rect.intersect(_stable_rect.offset(-dx, -dy));
+        // pixels reused from the previous zoom level move as well as the stable rect
+        auto dx = a_pixel() - a_px;
+        auto dy = b_pixel() - b_px;
+        if (-W < dx && dx < W && -H < dy && dy < H) {
+            buff.scroll(-dx, -dy);
+            if (dx > 0) {
+                buff.fill(rect_t(W - dx, 0, dx, H));
             }
-            else {
-                invalidate_buffer();
+            else if (dx < 0) {
+                buff.fill(rect_t(0, 0, -dx, H));
+            }
+            if (dy > 0) {
+                buff.fill(rect_t(0, H - dy, W, dy));
             }
+            else if (dy < 0) {
+                buff.fill(rect_t(0, 0, W, -dy));
+            }
+            _stable_rect = _stable_rect.intersect(_stable_rect.offset(-dx, -dy));
+            scroll_dirty(-dx, -dy);
+        }
+        else {
+            invalidate_buffer();
         }
 #else
         invalidate_buffer();
 #endif
     }
+
+    // escape count of the pixels of a view beyond VIEW_RANGE, which set_pos_coord() cannot center on
+    // (|a| >= 2 or |b| >= 2: z_1 = c escapes in any arithmetic)
+    static count_t outside_count(int max_loops) { return max_loops < 2 ? max_loops : 2; }
+
     void scroll(int da, int db) {
-        auto px_size = pixel_size();
+        auto px_size = pixel_size_coord();
         auto a = _a + px_size * da;
         auto b = _b + px_size * db;
-        set_pos(a, b);
+        set_pos_coord(a, b);
     }
 
     void invalidate_buffer() { 
+        reset_frame();
+#if MANDEL_ENABLE_ZOOM_REUSE
+        _preview = PREVIEW_NONE;
+#endif
         buff.fill();
         _stable_rect = rect_t();
     }
     rect_t stable_rect() const { return _stable_rect; }
-    bool no_change() const { return _stable_rect == buff.bounds(); }
+    bool no_change() const { return _stable_rect == buff.bounds() && next_max_loops() == _max_loops; }
+
+    // iteration limit of the pixels in the buffer
+    // (pixels with this value did not escape)
+    int max_loops() const { return _max_loops; }
 
+    // iteration limit from the next frame
+    // (with MANDEL_ENABLE_ADAPTIVE_LOOPS, this is adjusted after each frame)
+    void set_max_loops(int n) { _loops_target = limit(1, MAX_LOOPS, n); }
+
+    // zoom level in octaves (the pixel size is halved at each level)
     int zoom() const { return _zoom; }
-    bool set_zoom(int z) {
-        z = limit(0, MAX_ZOOM, z);
-        if (z == _zoom) return false;
-        _zoom = z;
+    bool set_zoom(int z) { return set_zoom_level(z * ZOOM_SUBSTEPS); }
+
+    // zoom level in 1 / ZOOM_SUBSTEPS octaves
+    int zoom_level() const { return _zoom * ZOOM_SUBSTEPS + _zoom_sub; }
+
+    // with MANDEL_ENABLE_ZOOM_REUSE, the buffer holds a preview resampled from
+    // the previous zoom level until the next render() (draw it before rendering)
+    bool set_zoom_level(int level) {
+        level = limit(0, max_zoom() * ZOOM_SUBSTEPS, level);
+        int diff = level - zoom_level();
+        if (diff == 0) return false;
+#if MANDEL_ENABLE_ZOOM_REUSE
+        if ((diff == ZOOM_SUBSTEPS || diff == -ZOOM_SUBSTEPS) && !_stable_rect.empty() && _preview == PREVIEW_NONE) {
+            // the pixel grids of the two levels are aligned
+            cancel_render();
+            reuse_zoom_pixels(level);
+            return true;
+        }
+        if (-ZOOM_SUBSTEPS <= diff && diff <= ZOOM_SUBSTEPS) {
+            resample_zoom_pixels(level);
+            return true;
+        }
+#endif
+        set_level(level);
         invalidate_buffer();
         return true;
     }
-    bool zoom_in() { return set_zoom(_zoom + 1); }
-    bool zoom_out() { return set_zoom(_zoom - 1); }
 
-    // a, b のピクセル座標のLSB位置
-    int pixel_lsb_pos() const { return FIXED_POINT_POS - PIXEL_SCALE_BITS - _zoom; }
+    // one octave in or out (the fractional part is kept)
+    bool zoom_in() { return set_zoom_level(zoom_level() + ZOOM_SUBSTEPS); }
+    bool zoom_out() { return set_zoom_level(zoom_level() - ZOOM_SUBSTEPS); }
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+    static constexpr int max_zoom() { return DEEP_MAX_ZOOM; }
+
+    // perturbation is used beyond MAX_ZOOM
+    bool is_deep() const { return zoom_ceil() > MAX_ZOOM; }
+#else
+    static constexpr int max_zoom() { return MAX_ZOOM; }
+    bool is_deep() const { return false; }
+#endif
+
+    // a, b のピクセル座標のLSB位置 (端数のズームレベルでは 1 ピクセルはこれより小さい)
+    int pixel_lsb_pos() const { return COORD_POINT_POS - PIXEL_SCALE_BITS - _zoom; }
 
     // a から 1 ピクセル未満の端数を除いた値
-    elem_t a_round() const { return round_elem(_a); }
+    coord_t a_round() const { return round_coord(_a); }
 
     // b から 1 ピクセル未満の端数を除いた値
-    elem_t b_round() const { return round_elem(_b); }
+    coord_t b_round() const { return round_coord(_b); }
 
-#if MANDEL_ENABLE_FIXED_POINT
     // 1ピクセルの a, b の変量
-    elem_t pixel_size() const { return FIXED(1) >> (PIXEL_SCALE_BITS + _zoom); }
+    coord_t pixel_size_coord() const { return _pixel_size; }
+    elem_t pixel_size() const { return coord_to_elem(pixel_size_coord()); }
 
-    // a, b からピクセル座標を抽出するためのマスク
-    elem_t round_elem(elem_t val) const {
-        elem_t mask = 1;
-        mask <<= pixel_lsb_pos();
-        mask -= 1;
-        mask = ~mask;
-        return val & mask; 
+    // a, b から 1 ピクセル未満の端数を除く
+    coord_t round_coord(coord_t val) const { return coord_to_pixel(val) * _pixel_size; }
+
+    // a, b のピクセル座標 (端数は切り捨て)
+    int64_t coord_to_pixel(coord_t val) const {
+        if (_zoom_sub == 0) return val >> pixel_lsb_pos();
+        int64_t q = val / _pixel_size;
+        return (val % _pixel_size < 0) ? q - 1 : q;
     }
 
     // a のピクセル座標
-    int32_t a_pixel() const { return a_round() >> pixel_lsb_pos(); }
+    int64_t a_pixel() const { return coord_to_pixel(_a); }
 
     // b のピクセル座標
-    int32_t b_pixel() const { return b_round() >> pixel_lsb_pos(); }
+    int64_t b_pixel() const { return coord_to_pixel(_b); }
+
+    // kernel precision for the current zoom level
+    precision_t precision() const {
+#if MANDEL_ENABLE_FIXED_POINT
+        const precision_t base = PRECISION_Q24;
 #else
-    // 1ピクセルの a, b の変量
-    elem_t pixel_size() const { return 1.0f / (1L << (PIXEL_SCALE_BITS + _zoom)); }
+        const precision_t base = PRECISION_F32;
+#endif
+#if MANDEL_ENABLE_PRECISION_TIERS
+        // fraction bits needed to resolve a pixel
+        int bits = PIXEL_SCALE_BITS + zoom_ceil() + PRECISION_GUARD_BITS;
+#if MANDEL_ENABLE_FIXED_POINT && MANDEL_ENABLE_Q12_TIER
+        if (bits <= precision_bits(PRECISION_Q12)) return PRECISION_Q12;
+#endif
+        if (bits <= precision_bits(base)) return base;
+#if PICO_ON_DEVICE
+        // double is emulated in software on Cortex-M0+, so the base precision
+        // is kept up to MAX_ZOOM without the guard bits
+        if (zoom_ceil() <= MAX_ZOOM) return base;
+#endif
+        return PRECISION_F64;
+#else
+        return base;
+#endif
+    }
+
+    // redraw area
+    // budget_us: time limit of this call (0: no limit, needs set_clock())
+    // returns true when the frame is complete, otherwise call again to continue
+    bool render(uint32_t budget_us = 0) {
+        uint32_t t_start = now_us();
+        uint32_t cached = 0;
+        if (!_rendering) {
+            cached = start_frame();
+        }
+
+        set_deadline(budget_us);
+
+        for (auto &tile : _tiles) {
+            tile.stats.clear();
+        }
+#if MANDEL_ENABLE_PROGRESSIVE
+        // with a time limit, each coarse pass is returned to be shown
+        if (_coarse_step > 0) {
+            do {
+                render_coarse_pass();
+            } while (_coarse_step > 0 && !_time_limited);
+        }
+        if (_coarse_step == 0)
+#endif
+        _executor->run(RENDER_TILES, render_tile_job, this);
+
+        stats.clear();
+        stats.cached = cached;
+        bool complete = true;
+        for (auto &tile : _tiles) {
+            stats.add(tile.stats);
+            complete &= tile.done;
+        }
+        stats.calls = 1;
+        stats.total_us = now_us() - t_start;
+        _frame_stats.add(stats);
+
+        if (complete) {
+            // the other pixels were in the buffer when the frame started
+            auto &s = _frame_stats;
+            uint32_t updated = s.pixels + s.cached + s.filled + s.interior;
+            s.reused = updated < (uint32_t)(W * H) ? W * H - updated : 0;
 
-    // a, b からピクセル座標を抽出するためのマスク
-    elem_t round_elem(elem_t val) const {
-        int lsb_pos = pixel_lsb_pos();
-        int32_t ival = val * (1L << -lsb_pos);
-        return (double)ival / (1L << -lsb_pos); 
+#if MANDEL_ENABLE_TILE_CACHE
+            store_cache_tiles();
+#endif
+#if MANDEL_ENABLE_ADAPTIVE_LOOPS
+            adapt_max_loops();
+#endif
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+            _rescan_stale = false;
+#endif
+#if MANDEL_ENABLE_ZOOM_REUSE || MANDEL_ENABLE_PROGRESSIVE
+            _lattice_seed = false;
+#endif
+            _rendering = false;
+            _stable_rect = buff.bounds();
+        }
+        return complete;
     }
 
-    // a のピクセル座標
-    int32_t a_pixel() const { return a_round() * (1L << -pixel_lsb_pos()); }
+    // a frame is partially rendered
+    bool rendering() const { return _rendering; }
 
-    // b のピクセル座標
-    int32_t b_pixel() const { return b_round() * (1L << -pixel_lsb_pos()); }
+    // statistics of all render() calls of the current frame (the last frame when complete)
+    const render_stats_t &frame_stats() const { return _frame_stats; }
+
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_GUARD_BAND
+    // calculate cache tiles around the screen while the view stays (no_change())
+    // so that scrolling finds the new pixels in the cache
+    // dx, dy: recent scroll direction, tiles on that side are calculated first
+    // budget_us: time limit of this call (0: no limit, needs set_clock())
+    // returns true when the band is complete
+    bool render_guard(int dx, int dy, uint32_t budget_us = 0) {
+        stats.clear();
+        if (!no_change()) return false;
+
+        dx = (dx > 0) - (dx < 0);
+        dy = (dy > 0) - (dy < 0);
+        if (dx != _guard_dx || dy != _guard_dy) {
+            _guard_dx = dx;
+            _guard_dy = dy;
+            reset_guard();
+        }
+        if (_guard_complete) return true;
+
+        set_deadline(budget_us);
+        while (!time_up()) {
+            int num_jobs = _guard_tiles < GUARD_BAND_MAX_TILES ? pick_guard_tiles() : 0;
+            if (num_jobs == 0) {
+                _guard_complete = true;
+                break;
+            }
+
+            for (auto &tile : _tiles) {
+                tile.stats.clear();
+            }
+            _executor->run(num_jobs, guard_tile_job, this);
+
+            for (int i = 0; i < num_jobs; i++) {
+                auto &job = _guard_jobs[i];
+                stats.add(_tiles[i].stats);
+                if (!job.done) continue;
+                _guard_tiles++;
+                auto *data = _cache.insert(zoom_level(), _max_loops, job.tx, job.ty);
+                for (int k = 0; k < TileCache::SIZE * TileCache::SIZE; k++) {
+                    data[k] = job.data[k];
+                }
+            }
+        }
+        return _guard_complete;
+    }
 #endif
 
-    // redraw area
-    void render() {
-        auto step = pixel_size();
-        auto a_offset = a_round() - step * (W / 2);
-        auto b_offset = b_round() - step * (H / 2);
+    // call func(y, x0, x1) for each row whose pixels x0 to (x1 - 1) may have new values
+    // since the last clear_dirty() (pixels not calculated yet are 0 and should be skipped)
+    template<typename F>
+    void for_each_dirty_span(F func) const {
+        for (int y = 0; y < H; y++) {
+            if (_dirty_x0[y] < _dirty_x1[y]) {
+                func(y, _dirty_x0[y], _dirty_x1[y]);
+            }
+        }
+    }
 
-#if MANDEL_ENABLE_BORDER_SCAN
-        // Border Scan Rendering
-        push_task_rect(buff.bounds(), false);
-        push_task_rect(_stable_rect, true);
+    void clear_dirty() {
+        for (int y = 0; y < H; y++) {
+            _dirty_x0[y] = W;
+            _dirty_x1[y] = 0;
+        }
+    }
+
+#if MANDEL_ENABLE_TILE_CACHE
+    // forget all cached tiles
+    void clear_cache() {
+        _cache.clear();
+#if MANDEL_ENABLE_GUARD_BAND
+        reset_guard();
+#endif
+    }
+#endif
+
+    clock_func_t clock() const { return _clock; }
+    void set_clock(clock_func_t clock) { _clock = clock; }
+
+    RenderExecutor *executor() const { return _executor; }
+    void set_executor(RenderExecutor *executor) {
+        _executor = executor ? executor : &_default_executor;
+    }
+
+private:
+    // prepare a new frame
+    // returns the number of pixels restored from the cache
+    uint32_t start_frame() {
+#if MANDEL_ENABLE_ZOOM_REUSE
+        drop_preview();
+#endif
+#if MANDEL_ENABLE_TILE_CACHE && MANDEL_ENABLE_GUARD_BAND
+        reset_guard();
+#endif
+        apply_max_loops(next_max_loops());
+        _frame_stats.clear();
+
+        auto step = pixel_size_coord();
+        _coord_step = step;
+        _a_coord_offset = a_round() - step * (W / 2);
+        _b_coord_offset = b_round() - step * (H / 2);
+        _precision = precision();
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+        if (is_deep()) {
+            // reference orbit at the center pixel (W/2, H/2)
+            _ref.compute(a_round(), b_round(), _max_loops);
+            _delta_step = (delta_t)step * COORD_TO_DELTA;
+        }
+#endif
+
+        // split screen into horizontal bands and render them in parallel
+        for (int i = 0; i < RENDER_TILES; i++) {
+            auto &tile = _tiles[i];
+            int y0 = H * i / RENDER_TILES;
+            int y1 = H * (i + 1) / RENDER_TILES;
+            tile.rect = rect_t(0, y0, W, y1 - y0);
+            tile.started = false;
+            tile.done = false;
+        }
+        _rendering = true;
 
-        pos_t pos;
-        while (queue.pop(&pos)) {
-            elem_t a = a_offset + step * pos.x;
-            elem_t b = b_offset + step * pos.y;
-            auto *val_ptr = buff.ptr(pos);
-            auto val = *val_ptr;
-            if (val < 2) {
-                val = 2 + mandelbrot_func(a, b);
-                *val_ptr = val;
+#if MANDEL_ENABLE_PROGRESSIVE
+        // nothing to show after a jump: start with the coarse passes
+        // (not while apply_max_loops() has marked pixels in _queued, which may share the words)
+        if (_stable_rect.empty() && !_lattice_seed
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+            && !_rescan_stale
+#endif
+        ) {
+            _coarse_step = PROGRESSIVE_STEP;
+        }
+#endif
+
+#if MANDEL_ENABLE_TILE_CACHE
+        return restore_cache_tiles();
+#else
+        return 0;
+#endif
+    }
+
+    void mark_dirty(pos_t p) {
+        if (p.x < _dirty_x0[p.y]) _dirty_x0[p.y] = p.x;
+        if (p.x >= _dirty_x1[p.y]) _dirty_x1[p.y] = p.x + 1;
+    }
+
+    void mark_dirty(rect_t rect) {
+        for (int y = rect.y; y < rect.b(); y++) {
+            if (rect.x < _dirty_x0[y]) _dirty_x0[y] = rect.x;
+            if (rect.r() > _dirty_x1[y]) _dirty_x1[y] = rect.r();
+        }
+    }
+
+    // move the dirty spans with the pixels (same as buff.scroll())
+    void scroll_dirty(int dx, int dy) {
+        int y_begin = dy > 0 ? H - 1 : 0;
+        int y_end = dy > 0 ? -1 : H;
+        int y_step = dy > 0 ? -1 : 1;
+        for (int y = y_begin; y != y_end; y += y_step) {
+            int src = y - dy;
+            int x0 = W, x1 = 0;
+            if (0 <= src && src < H && _dirty_x0[src] < _dirty_x1[src]) {
+                x0 = limit(0, W, _dirty_x0[src] + dx);
+                x1 = limit(0, W, _dirty_x1[src] + dx);
+            }
+            _dirty_x0[y] = x0 < x1 ? x0 : W;
+            _dirty_x1[y] = x0 < x1 ? x1 : 0;
+        }
+    }
+
+    // iteration limit of the next frame
+    int next_max_loops() const {
+#if MANDEL_ENABLE_ADAPTIVE_LOOPS
+        // lower bound for the zoom level
+        int min_loops = MIN_LOOPS << (_zoom / LOOPS_DOUBLING_ZOOM);
+        if (min_loops > MAX_LOOPS) min_loops = MAX_LOOPS;
+        return limit(min_loops, MAX_LOOPS, _loops_target);
+#else
+        return _loops_target;
+#endif
+    }
+
+    // change the iteration limit of the pixels in the buffer
+    //  - lowered: counts beyond the new limit are clipped
+    //  - raised: pixels that did not escape are recalculated
+    void apply_max_loops(int n) {
+        if (n == _max_loops) return;
+        int old = _max_loops;
+        _max_loops = n;
+
+        bool changed = false;
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                auto &v = buff[pos_t(x, y)];
+                if (v == 0) continue;
+                if (n < old && v > n) {
+                    v = n;
+                    mark_dirty(pos_t(x, y));
+                    changed = true;
+                }
+                else if (n > old && v >= old) {
+                    v = 0;
+                    changed = true;
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+                    _queued.set(pos_t(x, y));
+                    _rescan_stale = true;
+#endif
+                }
             }
-            push_neighbor_tasks(pos, val, -1,  0);
-            push_neighbor_tasks(pos, val,  1,  0);
-            push_neighbor_tasks(pos, val,  0, -1);
-            push_neighbor_tasks(pos, val,  0,  1);
         }
 
+        // the pixels have to be redrawn
+        if (changed) {
+            _stable_rect = rect_t();
+        }
+    }
+
+#if MANDEL_ENABLE_ADAPTIVE_LOOPS
+    // adjust the iteration limit to the escape counts of the completed frame
+    //  - many pixels escaped just before the limit: details are cut off, double it
+    //  - no pixel in the buffer escaped after a quarter of the limit: halve it
+    void adapt_max_loops() {
+        auto &s = _frame_stats;
+        if (s.escaped < LOOPS_ADAPT_MIN_PIXELS) return;
+
+        if (s.escaped_high * LOOPS_RAISE_RATIO > s.escaped) {
+            _loops_target = limit(MIN_LOOPS, MAX_LOOPS, _max_loops * 2);
+        }
+        else if (s.max_escaped * 4 < (uint32_t)_max_loops && max_escaped_in_buffer() * 4 < _max_loops) {
+            _loops_target = limit(MIN_LOOPS, MAX_LOOPS, _max_loops / 2);
+        }
+    }
+
+    // max escape count of the pixels in the buffer
+    int max_escaped_in_buffer() const {
+        int max_n = 0;
+        for (int i = 0; i < W * H; i++) {
+            int n = buff[i];
+            if (n < _max_loops && n > max_n) max_n = n;
+        }
+        return max_n;
+    }
+#endif
+
+#if MANDEL_ENABLE_TILE_CACHE
+    // fill unknown pixels with the cached tiles
+    uint32_t restore_cache_tiles() {
+        constexpr int B = CACHE_TILE_BITS;
+        constexpr int SIZE = TileCache::SIZE;
+        _x_origin = a_pixel() - W / 2;
+        _y_origin = b_pixel() - H / 2;
+        _frame_stable_rect = _stable_rect;
+        _num_restored = 0;
+
+        uint32_t pixels = 0;
+        for (int64_t ty = _y_origin >> B; ty <= (_y_origin + H - 1) >> B; ty++) {
+            for (int64_t tx = _x_origin >> B; tx <= (_x_origin + W - 1) >> B; tx++) {
+                rect_t rect((tx << B) - _x_origin, (ty << B) - _y_origin, SIZE, SIZE);
+                auto visible = rect.intersect(buff.bounds());
+                if (_stable_rect.intersect(visible) == visible) continue;
+
+                auto *data = _cache.find(zoom_level(), _max_loops, tx, ty);
+                if (!data) continue;
+
+                for (int y = visible.y; y < visible.b(); y++) {
+                    auto *src = data + (y - rect.y) * SIZE + (visible.x - rect.x);
+                    for (int x = visible.x; x < visible.r(); x++) {
+                        auto &dst = buff[pos_t(x, y)];
+                        if (dst == 0) {
+                            dst = *src;
+                            mark_dirty(pos_t(x, y));
+                            pixels++;
+                        }
+                        src++;
+                    }
+                }
+                _restored[_num_restored++] = visible;
+            }
+        }
+        return pixels;
+    }
+
+    // store the cache tiles calculated in this frame
+    void store_cache_tiles() {
+        constexpr int B = CACHE_TILE_BITS;
+        constexpr int SIZE = TileCache::SIZE;
+        for (int64_t ty = (_y_origin + SIZE - 1) >> B; ((ty + 1) << B) <= _y_origin + H; ty++) {
+            for (int64_t tx = (_x_origin + SIZE - 1) >> B; ((tx + 1) << B) <= _x_origin + W; tx++) {
+                rect_t rect((tx << B) - _x_origin, (ty << B) - _y_origin, SIZE, SIZE);
+                if (_frame_stable_rect.intersect(rect) == rect) continue;
+
+                auto *data = _cache.insert(zoom_level(), _max_loops, tx, ty);
+                for (int y = 0; y < SIZE; y++) {
+                    for (int x = 0; x < SIZE; x++) {
+                        *(data++) = buff[pos_t(rect.x + x, rect.y + y)];
+                    }
+                }
+            }
+        }
+    }
+
+#if MANDEL_ENABLE_GUARD_BAND
+    void reset_guard() {
+        _guard_complete = false;
+        _guard_tiles = 0;
+    }
+
+    // set up render jobs for the tiles of the band not cached yet
+    // returns the number of jobs
+    int pick_guard_tiles() {
+        constexpr int B = CACHE_TILE_BITS;
+        constexpr int SIZE = TileCache::SIZE;
+        constexpr int G = GUARD_BAND_TILES;
+
+        // tiles overlapping the screen
+        int64_t tx0 = _x_origin >> B, tx1 = (_x_origin + W - 1) >> B;
+        int64_t ty0 = _y_origin >> B, ty1 = (_y_origin + H - 1) >> B;
+
+        // tiles ahead of the scroll direction first, then nearer ones first
+        // (only GUARD_BAND_MAX_TILES tiles in this order are kept in the cache)
+        int num_jobs = 0;
+        int num_tiles = 0;
+        for (int ahead = 1; ahead >= 0; ahead--) {
+            for (int d = 0; d <= G; d++) {
+                for (int64_t ty = ty0 - G; ty <= ty1 + G; ty++) {
+                    for (int64_t tx = tx0 - G; tx <= tx1 + G; tx++) {
+                        rect_t rect((tx << B) - _x_origin, (ty << B) - _y_origin, SIZE, SIZE);
+                        if (buff.bounds().intersect(rect) == rect) continue;
+
+                        // distance from the screen (0: partially visible)
+                        int64_t dx = tx < tx0 ? tx0 - tx : (tx > tx1 ? tx - tx1 : 0);
+                        int64_t dy = ty < ty0 ? ty0 - ty : (ty > ty1 ? ty - ty1 : 0);
+                        if ((dx > dy ? dx : dy) != d) continue;
+
+                        bool is_ahead =
+                            (_guard_dx > 0 && rect.r() > W) || (_guard_dx < 0 && rect.x < 0) ||
+                            (_guard_dy > 0 && rect.b() > H) || (_guard_dy < 0 && rect.y < 0);
+                        if (is_ahead != (ahead == 1)) continue;
+
+                        if (++num_tiles > GUARD_BAND_MAX_TILES) return num_jobs;
+                        if (_cache.find(zoom_level(), _max_loops, tx, ty)) continue;
+
+                        auto &job = _guard_jobs[num_jobs];
+                        job.tx = tx;
+                        job.ty = ty;
+                        if (++num_jobs >= RENDER_TILES) return num_jobs;
+                    }
+                }
+            }
+        }
+        return num_jobs;
+    }
+
+    static void guard_tile_job(void *context, int job) {
+        auto *self = (TinyMandelbrot *)context;
+        self->calc_guard_tile(self->_tiles[job], self->_guard_jobs[job]);
+    }
+
+    // calculate a cache tile off the screen (visible pixels are copied from the buffer)
+    void calc_guard_tile(tile_t &tile, guard_job_t &job) {
+        constexpr int SIZE = TileCache::SIZE;
+        int x0 = (int)((job.tx << CACHE_TILE_BITS) - _x_origin);
+        int y0 = (int)((job.ty << CACHE_TILE_BITS) - _y_origin);
+        pos_t batch_pos[BATCH_SIZE];
+        count_t batch_n[BATCH_SIZE];
+        int16_t batch_index[BATCH_SIZE];
+
+        int num = 0;
+        auto flush = [&]() {
+            calc_counts(tile, batch_pos, batch_n, num);
+            for (int i = 0; i < num; i++) {
+                job.data[batch_index[i]] = batch_n[i];
+            }
+            num = 0;
+        };
+
+        job.done = false;
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                pos_t p(x0 + x, y0 + y);
+                if (buff.bounds().contains(p)) {
+                    job.data[y * SIZE + x] = buff[p];
+                    continue;
+                }
+                batch_index[num] = y * SIZE + x;
+                batch_pos[num++] = p;
+                if (num == BATCH_SIZE) flush();
+            }
+            if (num > 0) flush();
+            if (time_up()) return;
+        }
+        job.done = true;
+    }
+#endif
+#endif
+
+    // discard the incomplete frame
+    // pixels outside the stable rect may be left half done
+    void cancel_render() {
+        if (!_rendering) return;
+        reset_frame();
+        clear_unstable();
+    }
+
+    // forget the progress of the current frame (pixels are kept)
+    void reset_frame() {
+        _rendering = false;
+#if MANDEL_ENABLE_ZOOM_REUSE || MANDEL_ENABLE_PROGRESSIVE
+        _lattice_seed = false;
+#endif
+#if MANDEL_ENABLE_PROGRESSIVE
+        if (_coarse_step > 0) {
+            _coarse.clear();
+            _coarse_step = 0;
+        }
+#endif
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+        _queued.clear();
+        _rescan_stale = false;
+#endif
+    }
+
+    // clear pixels outside the stable rect
+    void clear_unstable() {
+        auto r = _stable_rect;
+        if (r.empty()) {
+            buff.fill();
+            return;
+        }
+        buff.fill(rect_t(0, 0, W, r.y));
+        buff.fill(rect_t(0, r.b(), W, H - r.b()));
+        buff.fill(rect_t(0, r.y, r.x, r.h));
+        buff.fill(rect_t(r.r(), r.y, W - r.r(), r.h));
+    }
+
+    // octave of the zoom level rounded up (for the precision of the pixel size)
+    int zoom_ceil() const { return _zoom + (_zoom_sub != 0 ? 1 : 0); }
+
+    void set_level(int level) {
+        _zoom = level / ZOOM_SUBSTEPS;
+        _zoom_sub = level % ZOOM_SUBSTEPS;
+        _pixel_size = level_pixel_size(_zoom, _zoom_sub);
+    }
+
+    // pixel size of the zoom level: 2^(-sub / ZOOM_SUBSTEPS) of the octave z
+    // (exactly half of the level one octave lower)
+    static coord_t level_pixel_size(int z, int sub) {
+        int lsb = COORD_POINT_POS - PIXEL_SCALE_BITS - z;
+        if (sub == 0) return ((coord_t)1) << lsb;
+
+        double m = exp2(-(double)sub / ZOOM_SUBSTEPS);
+        coord_t mantissa = (coord_t)(m * (1 << ZOOM_MANTISSA_BITS) + 0.5);
+        return mantissa << (lsb - ZOOM_MANTISSA_BITS);
+    }
+
+#if MANDEL_ENABLE_ZOOM_REUSE
+    // recalculate the preview pixels from the next frame
+    // (they stay on the screen until overwritten because 0 is not drawn)
+    void drop_preview() {
+        if (_preview == PREVIEW_UNSTABLE) {
+            clear_unstable();
+        }
+        else if (_preview == PREVIEW_LATTICE) {
+            int lx = (int)((a_pixel() - W / 2) & 1);
+            int ly = (int)((b_pixel() - H / 2) & 1);
+            for (int y = 0; y < H; y++) {
+                bool lattice_row = ((y + ly) & 1) == 0;
+                for (int x = 0; x < W; x++) {
+                    if (!lattice_row || ((x + lx) & 1) != 0) {
+                        buff[pos_t(x, y)] = 0;
+                    }
+                }
+            }
+        }
+        _preview = PREVIEW_NONE;
+    }
+
+    // resample pixels of the current view to the zoom level with nearest neighbors
+    // (any step within an octave; all pixels are shown as a preview and recalculated)
+    void resample_zoom_pixels(int level) {
+        // pixels of the incomplete frame are good enough for a preview
+        reset_frame();
+
+        coord_t old_size = _pixel_size;
+        int64_t x_old = a_pixel() - W / 2;
+        int64_t y_old = b_pixel() - H / 2;
+        set_level(level);
+        int64_t x_new = a_pixel() - W / 2;
+        int64_t y_new = b_pixel() - H / 2;
+
+        // rows and columns are accessed with pointers
+        buff.linearize();
+        int16_t map[W > H ? W : H];
+        count_t line[W > H ? W : H];
+        nearest_map(map, W, x_old, x_new, old_size);
+        for (int y = 0; y < H; y++) {
+            auto *p = buff.ptr(0, y);
+            for (int x = 0; x < W; x++) line[x] = p[x];
+            for (int x = 0; x < W; x++) p[x] = line[map[x]];
+        }
+        nearest_map(map, H, y_old, y_new, old_size);
+        for (int x = 0; x < W; x++) {
+            auto *p = buff.ptr(x, 0);
+            for (int y = 0; y < H; y++) line[y] = p[y * buff.STRIDE];
+            for (int y = 0; y < H; y++) p[y * buff.STRIDE] = line[map[y]];
+        }
+
+        // pixels not calculated yet take the value on the left
         count_t last_n = 0;
+        for (int i = 0; i < W * H; i++) {
+            if (buff[i] == 0) buff[i] = last_n;
+            else last_n = buff[i];
+        }
+
+        mark_dirty(buff.bounds());
+        _stable_rect = rect_t();
+        _preview = PREVIEW_UNSTABLE;
+    }
+
+    // map[i]: old pixel nearest to the new pixel i (clamped to the line)
+    // pixel i is at the global position o_new + i after and o_old + i before
+    void nearest_map(int16_t *map, int n, int64_t o_old, int64_t o_new, coord_t old_size) const {
+        for (int i = 0; i < n; i++) {
+            coord_t c = (o_new + i) * _pixel_size + old_size / 2;
+            int64_t src = c / old_size;
+            if (c % old_size < 0) src--;
+            map[i] = (int16_t)limit<int64_t>(0, n - 1, src - o_old);
+        }
+    }
+
+    // move pixels of the current zoom level to the zoom level one octave above or below
+    // zoom in: every other pixel of the center quarter is known, the others are a preview
+    // zoom out: the center quarter is filled and becomes the stable rect,
+    //           the surrounding pixels are a preview extended from its edges
+    void reuse_zoom_pixels(int level) {
+        bool zoom_in = level > zoom_level();
+        int64_t x_old = a_pixel() - W / 2;
+        int64_t y_old = b_pixel() - H / 2;
+        auto old_stable = _stable_rect;
+        set_level(level);
+
+        // resample_line() needs plain rows and columns
+        buff.linearize();
+        int64_t x_new = a_pixel() - W / 2;
+        int64_t y_new = b_pixel() - H / 2;
+
+        for (int y = 0; y < H; y++) {
+            resample_line(buff.ptr(0, y), 1, W, x_old, x_new, zoom_in);
+        }
+        for (int x = 0; x < W; x++) {
+            resample_line(buff.ptr(x, 0), buff.STRIDE, H, y_old, y_new, zoom_in);
+        }
+
+        mark_dirty(buff.bounds());
+
+        if (zoom_in) {
+            _stable_rect = rect_t();
+            _lattice_seed = true;
+            preview_lattice();
+        }
+        else {
+            // new pixels whose source is in the old stable rect
+            int x0 = W, x1 = 0, y0 = H, y1 = 0;
+            for (int x = 0; x < W; x++) {
+                int64_t src = (x_new + x) * 2 - x_old;
+                if (old_stable.x <= src && src < old_stable.r()) {
+                    if (x < x0) x0 = x;
+                    x1 = x + 1;
+                }
+            }
+            for (int y = 0; y < H; y++) {
+                int64_t src = (y_new + y) * 2 - y_old;
+                if (old_stable.y <= src && src < old_stable.b()) {
+                    if (y < y0) y0 = y;
+                    y1 = y + 1;
+                }
+            }
+            _stable_rect = x0 < x1 && y0 < y1 ? rect_t::from_ltrb(x0, y0, x1, y1) : rect_t();
+            _lattice_seed = false;
+            preview_unstable();
+        }
+    }
+
+    // copy the nearest pixel on the even global grid to the pixels off the grid
+    void preview_lattice() {
+        int lx = (int)((a_pixel() - W / 2) & 1);
+        int ly = (int)((b_pixel() - H / 2) & 1);
+        for (int y = 0; y < H; y++) {
+            int sy = ((y + ly) & 1) == 0 ? y : (y > 0 ? y - 1 : y + 1);
+            for (int x = 0; x < W; x++) {
+                int sx = ((x + lx) & 1) == 0 ? x : (x > 0 ? x - 1 : x + 1);
+                if (sx != x || sy != y) {
+                    buff[pos_t(x, y)] = buff[pos_t(sx, sy)];
+                }
+            }
+        }
+        _preview = PREVIEW_LATTICE;
+    }
+
+    // copy the nearest pixel in the stable rect to the pixels outside it
+    void preview_unstable() {
+        auto r = _stable_rect;
+        if (r.empty()) return;
         for (int y = 0; y < H; y++) {
-            auto *ptr = buff.ptr(0, y);
+            int sy = limit<int>(r.y, r.b() - 1, y);
             for (int x = 0; x < W; x++) {
-                auto n = *ptr;
-                if (n == 0) {
-                    *ptr = last_n;
+                if (r.contains(pos_t(x, y))) continue;
+                int sx = limit<int>(r.x, r.r() - 1, x);
+                buff[pos_t(x, y)] = buff[pos_t(sx, sy)];
+            }
+        }
+        _preview = PREVIEW_UNSTABLE;
+    }
+
+    // resample a line of pixels in place
+    // pixel i is at the global position o_new + i after and o_old + i before,
+    // one new pixel is a half (zoom in) or twice (zoom out) of an old pixel
+    static void resample_line(count_t *p, int stride, int n, int64_t o_old, int64_t o_new, bool zoom_in) {
+        auto copy = [&](int i) {
+            int64_t g = o_new + i;
+            int64_t src = zoom_in ? ((g & 1) ? -1 : (g >> 1) - o_old) : g * 2 - o_old;
+            p[i * stride] = (0 <= src && src < n) ? p[src * stride] : 0;
+        };
+
+        // the pixel which reads itself; the others are processed so that
+        // the sources are not overwritten yet
+        int64_t fixed = zoom_in ? o_new - o_old * 2 : o_old - o_new * 2;
+        int mid = (int)limit<int64_t>(0, n, fixed);
+        if (zoom_in) {
+            for (int i = 0; i < mid; i++) copy(i);
+            for (int i = n - 1; i >= mid; i--) copy(i);
+        }
+        else {
+            for (int i = mid - 1; i >= 0; i--) copy(i);
+            for (int i = mid; i < n; i++) copy(i);
+        }
+    }
+#endif
+
+    void set_deadline(uint32_t budget_us) {
+        _time_limited = budget_us > 0 && _clock;
+        if (_time_limited) {
+            _deadline_us = _clock() + budget_us;
+        }
+    }
+
+    // the time limit of render() has passed
+    bool time_up() const {
+        return _time_limited && (int32_t)(_clock() - _deadline_us) >= 0;
+    }
+
+    // current time for the statistics (0 without set_clock())
+    uint32_t now_us() const { return _clock ? _clock() : 0; }
+
+#if MANDEL_ENABLE_PROGRESSIVE
+    // calculate the lattice of _coarse_step, then fill the blocks between the lattice points
+    // with a corner as a preview until the next pass refines them
+    // (blocks whose corners agree are not trusted either: a filament may cross them)
+    // after the last pass, the previews are dropped for the scan (they stay on the screen until then)
+    void render_coarse_pass() {
+        if (_coarse_step == 1) {
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    if (_coarse.get(pos_t(x, y))) {
+                        buff[pos_t(x, y)] = 0;
+                    }
                 }
-                else {
-                    last_n = n;
+            }
+            _coarse.clear();
+            _coarse_step = 0;
+            _lattice_seed = true;
+            return;
+        }
+
+        _coarse_fill = false;
+        _executor->run(RENDER_TILES, coarse_tile_job, this);
+        _coarse_fill = true;
+        _executor->run(RENDER_TILES, coarse_tile_job, this);
+        _coarse_step /= 2;
+    }
+
+    static void coarse_tile_job(void *context, int job) {
+        auto *self = (TinyMandelbrot *)context;
+        auto &tile = self->_tiles[job];
+        uint32_t t_start = self->now_us();
+        if (self->_coarse_fill) {
+            self->fill_coarse_blocks(tile);
+        }
+        else {
+            self->calc_coarse_points(tile);
+        }
+        tile.stats.scan_us += self->now_us() - t_start;
+    }
+
+    // first lattice column / row of the pass in the buffer
+    // the lattice of step s is on the multiples of s in the global pixel coordinates,
+    // so the blocks do not move with the view (and the even points are the ones reused by zoom)
+    int coarse_x(int s) const { return (int)(-(a_pixel() - W / 2) & (s - 1)); }
+    int coarse_y(int s) const { return (int)(-(b_pixel() - H / 2) & (s - 1)); }
+
+    // calculate the lattice points in the rows of the tile that are not known yet
+    void calc_coarse_points(tile_t &tile) {
+        int s = _coarse_step;
+        int cx = coarse_x(s);
+        int cy = coarse_y(s);
+        pos_t batch_pos[BATCH_SIZE];
+        count_t batch_n[BATCH_SIZE];
+        int num = 0;
+        for (int y = tile.rect.y + ((cy - tile.rect.y) & (s - 1)); y < tile.rect.b(); y += s) {
+            for (int x = cx; x < W; x += s) {
+                pos_t p(x, y);
+                if (buff[p] != 0 && !_coarse.get(p)) continue;
+                _coarse.reset(p);
+                batch_pos[num++] = p;
+                if (num == BATCH_SIZE) {
+                    calc_pixels(tile, batch_pos, batch_n, num);
+                    num = 0;
+                }
+            }
+        }
+        calc_pixels(tile, batch_pos, batch_n, num);
+    }
+
+    // fill the unknown pixels in the rows of the tile with the values of their blocks
+    void fill_coarse_blocks(tile_t &tile) {
+        int s = _coarse_step;
+        int cx = coarse_x(s);
+        int cy = coarse_y(s);
+        for (int y = tile.rect.y; y < tile.rect.b(); y++) {
+            // corners of the block (outside the buffer: 0)
+            int y0 = y - ((y - cy) & (s - 1));
+            int y1 = y0 + s;
+            for (int x0 = cx > 0 ? cx - s : cx; x0 < W; x0 += s) {
+                int x1 = x0 + s;
+                count_t corners[4] = {
+                    coarse_corner(x0, y0), coarse_corner(x1, y0),
+                    coarse_corner(x0, y1), coarse_corner(x1, y1)
+                };
+                count_t val = 0;
+                for (auto c : corners) {
+                    if (val == 0) val = c;
+                }
+
+                int xs = x0 > 0 ? x0 : 0;
+                int xe = x1 < W ? x1 : W;
+                for (int x = xs; x < xe; x++) {
+                    pos_t p(x, y);
+                    auto &pixel = buff[p];
+                    if (pixel != 0 && !_coarse.get(p)) continue;
+                    pixel = val;
+                    _coarse.set(p);
+                }
+                mark_dirty(rect_t(xs, y, xe - xs, 1));
+            }
+        }
+    }
+
+    count_t coarse_corner(int x, int y) const {
+        if (x < 0 || W <= x || y < 0 || H <= y) return 0;
+        return buff[pos_t(x, y)];
+    }
+#endif
+
+    static void render_tile_job(void *context, int job) {
+        auto *self = (TinyMandelbrot *)context;
+        auto &tile = self->_tiles[job];
+        uint32_t t_start = self->now_us();
+        self->render_tile(tile);
+        tile.stats.scan_us += self->now_us() - t_start - tile.stats.fill_us;
+    }
+
+    // redraw area in the tile
+    // returns when the tile is done or the time limit has passed
+    void render_tile(tile_t &tile) {
+        if (tile.done) return;
+
+        if (!tile.started) {
+            tile.started = true;
+#if MANDEL_ENABLE_DEEP_ZOOM
+            tile.num_refs = 0;
+            tile.next_ref = 0;
+#endif
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+            tile.queue.reset(tile.rect.y, tile.rect.h);
+            if (_rescan_stale) {
+                // find the pixels marked by apply_max_loops()
+                tile.overflow_y0 = tile.rect.y;
+                tile.overflow_y1 = tile.rect.b();
+            }
+            else {
+                tile.overflow_y0 = tile.rect.b();
+                tile.overflow_y1 = tile.rect.y;
+            }
+            push_task_rect(tile, tile.rect, false);
+            push_task_rect(tile, _stable_rect, true);
+#if MANDEL_ENABLE_TILE_CACHE
+            // edges of the restored areas are examined like calculated pixels
+            for (int i = 0; i < _num_restored; i++) {
+                push_known_rect(tile, _restored[i]);
+            }
+#endif
+#if MANDEL_ENABLE_ZOOM_REUSE || MANDEL_ENABLE_PROGRESSIVE
+            tile.lattice_pos = 0;
+#endif
+#elif MANDEL_SCAN_MODE == MANDEL_SCAN_RECT
+            tile.rects.clear();
+            tile.rects.push(tile.rect);
+#else
+            tile.next_y = tile.rect.y;
+#endif
+        }
+
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+        // Border Scan Rendering
+        auto &queue = tile.queue;
+        int y0 = tile.rect.y;
+        int y1 = tile.rect.b();
+        pos_t batch_pos[BATCH_SIZE];
+        count_t batch_n[BATCH_SIZE];
+
+        pos_t popped[BATCH_SIZE];
+        while (true) {
+#if MANDEL_ENABLE_ZOOM_REUSE || MANDEL_ENABLE_PROGRESSIVE
+            if (_lattice_seed) {
+                push_lattice_edges(tile);
+            }
+#endif
+            if (queue.empty()) {
+                if (tile.overflow_y0 >= tile.overflow_y1) break;
+                rescan_overflow_row(tile);
+                continue;
+            }
+
+            // collect queued pixels
+            int num_popped = 0, num_calc = 0;
+            pos_t pos;
+            while (num_popped < BATCH_SIZE && queue.pop(&pos)) {
+                _queued.reset(pos);
+                if (buff[pos] == 0) {
+                    batch_pos[num_calc++] = pos;
                 }
-                ptr++;
+                popped[num_popped++] = pos;
+            }
+
+            calc_pixels(tile, batch_pos, batch_n, num_calc);
+
+            for (int i = 0; i < num_popped; i++) {
+                pos = popped[i];
+                auto val = buff[pos];
+                push_neighbor_tasks(tile, pos, val, -1,  0);
+                push_neighbor_tasks(tile, pos, val,  1,  0);
+                push_neighbor_tasks(tile, pos, val,  0, -1);
+                push_neighbor_tasks(tile, pos, val,  0,  1);
             }
+
+            tile.stats.queue_peak = queue.peak();
+            if (time_up()) return;
+        }
+
+        uint32_t t_fill = now_us();
+        count_t last_n = 0;
+        for (int y = y0; y < y1; y++) {
+            buff.for_each_segment(y, 0, W, [&](count_t *ptr, int16_t x0, int16_t n) {
+                for (int x = x0; x < x0 + n; x++) {
+                    if (*ptr == 0) {
+                        *ptr = last_n;
+                        mark_dirty(pos_t(x, y));
+                        tile.stats.filled++;
+                    }
+                    else {
+                        last_n = *ptr;
+                    }
+                    ptr++;
+                }
+            });
+        }
+        tile.stats.fill_us += now_us() - t_fill;
+#elif MANDEL_SCAN_MODE == MANDEL_SCAN_RECT
+        // Rectangle Subdivision Rendering
+        rect_t rect;
+        while (tile.rects.pop(&rect)) {
+            scan_rect(tile, rect);
+            if (time_up()) return;
         }
 #else
         // Raster Scan Rendering
-        auto b = b_offset;
+        int y1 = tile.rect.b();
+        pos_t batch_pos[BATCH_SIZE];
+        count_t batch_n[BATCH_SIZE];
         int stable_rect_r = _stable_rect.r();
         int stable_rect_b = _stable_rect.b();
-        for (int y = 0; y < H; y++) {
-            auto a = a_offset;
-            for (int x = 0; x < W; x++) {
-                if (x < _stable_rect.x || stable_rect_r <= x || y < _stable_rect.y || stable_rect_b <= y) {
-                    *buff.ptr(x, y) = 2 + mandelbrot_func(a, b);
+        while (tile.next_y < y1) {
+            int y = tile.next_y++;
+            int x = 0;
+            while (x < W) {
+                int num = 0;
+                for (; x < W && num < BATCH_SIZE; x++) {
+                    bool stable = _stable_rect.x <= x && x < stable_rect_r && _stable_rect.y <= y && y < stable_rect_b;
+                    if (!stable && buff[pos_t(x, y)] == 0) {
+                        batch_pos[num++] = pos_t(x, y);
+                    }
                 }
-                a += step;
+                calc_pixels(tile, batch_pos, batch_n, num);
             }
-            b += step;
+            if (time_up()) return;
         }
 #endif
 
-        _stable_rect = buff.bounds();
+        tile.done = true;
     }
 
-private:
-    void push_task_rect(rect_t rect, bool force) {
+    // calculate pixels and store the results to the buffer
+    void calc_pixels(tile_t &tile, const pos_t *pos, count_t *result, int num) {
+        calc_counts(tile, pos, result, num);
+        for (int i = 0; i < num; i++) {
+            buff[pos[i]] = result[i];
+            mark_dirty(pos[i]);
+        }
+    }
+
+    // calculate loop counts of pixels (the positions may be outside the buffer)
+    void calc_counts(tile_t &tile, const pos_t *pos_in, count_t *result_out, int num_in) {
+#if MANDEL_ENABLE_INTERIOR_CHECK
+        // pixels in the main cardioid or the period-2 bulb never escape
+        pos_t pos[BATCH_SIZE];
+        int16_t index[BATCH_SIZE];
+        count_t result[BATCH_SIZE];
+        int num = 0;
+        for (int i = 0; i < num_in; i++) {
+            auto p = pos_in[i];
+            if (is_main_body(a_coord_at(p.x), b_coord_at(p.y))) {
+                result_out[i] = _max_loops;
+                tile.stats.interior++;
+            }
+            else {
+                index[num] = i;
+                pos[num++] = p;
+            }
+        }
+#else
+        const pos_t *pos = pos_in;
+        count_t *result = result_out;
+        int num = num_in;
+#endif
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+        if (is_deep()) {
+            for (int i = 0; i < num; i++) {
+                result[i] = calc_deep(tile, pos[i]);
+            }
+        }
+        else
+#endif
+        {
+            switch (_precision) {
+#if MANDEL_ENABLE_FIXED_POINT
+            case PRECISION_Q12:
+                calc_q12(pos, result, num);
+                break;
+#endif
+            case PRECISION_F64:
+                calc_f64(pos, result, num);
+                break;
+            default:
+                calc_elem(pos, result, num);
+                break;
+            }
+
+            for (int i = 0; i < num; i++) {
+                tile.stats.count(result[i], _max_loops);
+            }
+        }
+
+#if MANDEL_ENABLE_INTERIOR_CHECK
+        for (int i = 0; i < num; i++) {
+            result_out[index[i]] = result[i];
+        }
+#endif
+    }
+
+    // a, b of the pixel
+    coord_t a_coord_at(int x) const { return _a_coord_offset + _coord_step * x; }
+    coord_t b_coord_at(int y) const { return _b_coord_offset + _coord_step * y; }
+
+    // calculate pixels with elem_t
+    void calc_elem(const pos_t *pos, count_t *result, int num) {
+        elem_t a[BATCH_SIZE], b[BATCH_SIZE];
+        for (int i = 0; i < num; i++) {
+            // from the exact position so that a pixel gets the same value in any view
+            // (the pixel size in elem_t is not exact at fractional zoom levels)
+            a[i] = coord_to_elem(a_coord_at(pos[i].x));
+            b[i] = coord_to_elem(b_coord_at(pos[i].y));
+        }
+#if MANDEL_ENABLE_BATCH
+        mandelbrot_batch(a, b, result, num, _max_loops);
+#else
+        for (int i = 0; i < num; i++) {
+            result[i] = mandelbrot_func(a[i], b[i], _max_loops);
+        }
+#endif
+    }
+
+    // calculate pixels with double
+    void calc_f64(const pos_t *pos, count_t *result, int num) {
+        double a[BATCH_SIZE], b[BATCH_SIZE];
+        for (int i = 0; i < num; i++) {
+            a[i] = coord_to_f64(a_coord_at(pos[i].x));
+            b[i] = coord_to_f64(b_coord_at(pos[i].y));
+        }
+#if MANDEL_ENABLE_BATCH
+        mandelbrot_batch_f64(a, b, result, num, _max_loops);
+#else
+        for (int i = 0; i < num; i++) {
+            result[i] = mandelbrot_func_f64(a[i], b[i], _max_loops);
+        }
+#endif
+    }
+
+#if MANDEL_ENABLE_FIXED_POINT
+    // calculate pixels with Q4.12
+    void calc_q12(const pos_t *pos, count_t *result, int num) {
+        int16_t a[BATCH_SIZE], b[BATCH_SIZE];
+        for (int i = 0; i < num; i++) {
+            a[i] = coord_to_q12(a_coord_at(pos[i].x));
+            b[i] = coord_to_q12(b_coord_at(pos[i].y));
+        }
+#if MANDEL_ENABLE_BATCH
+        mandelbrot_batch_q12(a, b, result, num, _max_loops);
+#else
+        for (int i = 0; i < num; i++) {
+            result[i] = mandelbrot_func_q12(a[i], b[i], _max_loops);
+        }
+#endif
+    }
+#endif
+
+#if MANDEL_ENABLE_DEEP_ZOOM
+    // calculate a pixel with perturbation
+    count_t calc_deep(tile_t &tile, pos_t pos) {
+        bool glitch;
+        count_t n = perturbation_func(_ref,
+            (pos.x - W / 2) * _delta_step,
+            (pos.y - H / 2) * _delta_step,
+            _max_loops, &glitch);
+
+        // retry with the reference orbits made for other glitched pixels
+        for (int i = 0; glitch && i < tile.num_refs; i++) {
+            tile.stats.loops += n;
+            n = perturbation_func(tile.refs[i],
+                (pos.x - tile.ref_pos[i].x) * _delta_step,
+                (pos.y - tile.ref_pos[i].y) * _delta_step,
+                _max_loops, &glitch);
+        }
+
+        if (glitch) {
+            // make a new reference orbit at this pixel
+            tile.stats.loops += n;
+            int i = tile.next_ref;
+            tile.next_ref = (i + 1) % (MAX_REFERENCES - 1);
+            if (tile.num_refs < MAX_REFERENCES - 1) tile.num_refs++;
+
+            coord_t step = pixel_size_coord();
+            tile.refs[i].compute(
+                a_round() + step * (pos.x - W / 2),
+                b_round() + step * (pos.y - H / 2),
+                _max_loops);
+            tile.ref_pos[i] = pos;
+            tile.stats.refs++;
+
+            n = perturbation_func(tile.refs[i], 0, 0, _max_loops, &glitch);
+        }
+
+        tile.stats.count(n, _max_loops);
+        return n;
+    }
+#endif
+
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_RECT
+    // calculate the perimeter of the rect, then fill it if the perimeter
+    // has only one value, otherwise split it into two and push them
+    void scan_rect(tile_t &tile, rect_t rect) {
+        // pixels reused from the previous frame
+        if (_stable_rect.intersect(rect) == rect) return;
+
+        calc_perimeter(tile, rect);
+        if (rect.w <= 2 || rect.h <= 2) return;
+
+        auto val = buff[pos_t(rect.x, rect.y)];
+        bool uniform = true;
+        for_each_perimeter(rect, [&](pos_t pos) {
+            if (buff[pos] != val) uniform = false;
+        });
+
+        if (uniform) {
+            for (int y = rect.y + 1; y < rect.b() - 1; y++) {
+                for (int x = rect.x + 1; x < rect.r() - 1; x++) {
+                    auto &pixel = buff[pos_t(x, y)];
+                    if (pixel == 0) {
+                        pixel = val;
+                        mark_dirty(pos_t(x, y));
+                        tile.stats.filled++;
+                    }
+                }
+            }
+        }
+        else if (tile.rects.CAPACITY - tile.rects.size() < 2) {
+            // no room to split: calculate everything inside
+            calc_inner(tile, rect);
+        }
+        else if (rect.w >= rect.h) {
+            // the children share the dividing column
+            int w = rect.w / 2;
+            tile.rects.push(rect_t(rect.x + w, rect.y, rect.w - w, rect.h));
+            tile.rects.push(rect_t(rect.x, rect.y, w + 1, rect.h));
+        }
+        else {
+            int h = rect.h / 2;
+            tile.rects.push(rect_t(rect.x, rect.y + h, rect.w, rect.h - h));
+            tile.rects.push(rect_t(rect.x, rect.y, rect.w, h + 1));
+        }
+    }
+
+    // calculate unknown pixels inside the perimeter of the rect
+    void calc_inner(tile_t &tile, rect_t rect) {
+        for (int y = rect.y + 1; y < rect.b() - 1; y++) {
+            calc_perimeter(tile, rect_t(rect.x + 1, y, rect.w - 2, 1));
+        }
+    }
+
+    // calculate unknown pixels on the perimeter of the rect
+    void calc_perimeter(tile_t &tile, rect_t rect) {
+        pos_t batch_pos[BATCH_SIZE];
+        count_t batch_n[BATCH_SIZE];
+        int num = 0;
+        for_each_perimeter(rect, [&](pos_t pos) {
+            if (buff[pos] != 0) return;
+            batch_pos[num++] = pos;
+            if (num == BATCH_SIZE) {
+                calc_pixels(tile, batch_pos, batch_n, num);
+                num = 0;
+            }
+        });
+        calc_pixels(tile, batch_pos, batch_n, num);
+    }
+#endif
+
+    // call func for each pixel on the perimeter of the rect
+    template<typename F>
+    static void for_each_perimeter(rect_t rect, F func) {
         int x0 = rect.x, x1 = rect.r();
         int y0 = rect.y, y1 = rect.b();
+        if (rect.w <= 0 || rect.h <= 0) return;
 
         for (int x = x0; x < x1; x++) {
-            push_task(pos_t(x, y0), force);
-            if (rect.w >= 2) {
-                push_task(pos_t(x, y1 - 1), force);
+            func(pos_t(x, y0));
+            if (rect.h >= 2) {
+                func(pos_t(x, y1 - 1));
             }
         }
 
         for (int y = y0 + 1; y < y1 - 1; y++) {
-            push_task(pos_t(x0, y), force);
-            if (rect.h >= 2) {
-                push_task(pos_t(x1 - 1, y), force);
+            func(pos_t(x0, y));
+            if (rect.w >= 2) {
+                func(pos_t(x1 - 1, y));
             }
         }
     }
 
+#if MANDEL_SCAN_MODE == MANDEL_SCAN_BORDER
+    // enqueue the perimeter of the rect (only the part inside the tile)
+    void push_task_rect(tile_t &tile, rect_t rect, bool force) {
+        for_each_perimeter(rect, [&](pos_t pos) {
+            push_task(tile, pos, force);
+        });
+    }
+
+    // enqueue the perimeter of the calculated rect to detect edges around it
+    void push_known_rect(tile_t &tile, rect_t rect) {
+        for_each_perimeter(rect, [&](pos_t pos) {
+            if (tile.rect.contains(pos) && buff[pos] != 0) {
+                push_task(tile, pos, true);
+            }
+        });
+    }
+
+#if MANDEL_ENABLE_ZOOM_REUSE || MANDEL_ENABLE_PROGRESSIVE
+    // enqueue pixels between known lattice pixels that have different values
+    // continues from tile.lattice_pos while the queue has room
+    void push_lattice_edges(tile_t &tile) {
+        int lx = (int)((a_pixel() - W / 2) & 1);
+        int ly = (int)((b_pixel() - H / 2) & 1);
+        auto r = tile.rect;
+        int area = r.w * r.h;
+        while (tile.lattice_pos < area && tile.queue.size() < tile.queue.CAPACITY / 2) {
+            int x = r.x + tile.lattice_pos % r.w;
+            int y = r.y + tile.lattice_pos / r.w;
+            tile.lattice_pos++;
+
+            bool lattice_row = ((y + ly) & 1) == 0;
+            bool lattice_col = ((x + lx) & 1) == 0;
+            pos_t p, q;
+            if (lattice_row && !lattice_col) {
+                p = pos_t(x - 1, y);
+                q = pos_t(x + 1, y);
+            }
+            else if (!lattice_row && lattice_col) {
+                p = pos_t(x, y - 1);
+                q = pos_t(x, y + 1);
+            }
+            else {
+                continue;
+            }
+            if (!r.contains(p) || !r.contains(q)) continue;
+            auto val_p = buff[p];
+            auto val_q = buff[q];
+            if (val_p != 0 && val_q != 0 && val_p != val_q) {
+                push_task(tile, pos_t(x, y), false);
+            }
+        }
+    }
+#endif
+
     // enqueue calculation task
-    void push_task(pos_t pos, bool force) {
-        if (!buff.bounds().contains(pos)) return;
-        auto &pixel = buff[pos];
-        if (pixel != 0 && !force) return;
-        pixel = 1;
-        queue.push(pos);
+    // force: a calculated pixel is also pushed to examine its neighbors
+    void push_task(tile_t &tile, pos_t pos, bool force) {
+        if (!tile.rect.contains(pos)) return;
+        if (_queued.get(pos)) return;
+        if (buff[pos] != 0 && !force) return;
+        _queued.set(pos);
+        enqueue(tile, pos);
+    }
+
+    // push to the queue
+    // a pixel that does not fit is left in the buffer and its row is rescanned later
+    void enqueue(tile_t &tile, pos_t pos) {
+        if (tile.queue.push(pos)) return;
+        tile.stats.overflows++;
+        if (pos.y < tile.overflow_y0) tile.overflow_y0 = pos.y;
+        if (pos.y + 1 > tile.overflow_y1) tile.overflow_y1 = pos.y + 1;
+    }
+
+    // recover dropped pixels in the first row of the overflow range
+    // (called when the queue is empty, so every pixel marked as queued has been dropped)
+    //  - queued pixels are pushed again
+    //  - calculated pixels are examined for edges like popped pixels
+    void rescan_overflow_row(tile_t &tile) {
+        int y = tile.overflow_y0++;
+        for (int x = 0; x < W; x++) {
+            pos_t pos(x, y);
+            auto val = buff[pos];
+            if (_queued.get(pos)) {
+                enqueue(tile, pos);
+            }
+            else if (val != 0) {
+                push_neighbor_tasks(tile, pos, val, -1,  0);
+                push_neighbor_tasks(tile, pos, val,  1,  0);
+                push_neighbor_tasks(tile, pos, val,  0, -1);
+                push_neighbor_tasks(tile, pos, val,  0,  1);
+            }
+        }
     }
 
     // detect edge and push neighbors
@@ -263,80 +1890,31 @@ private:
     //  |new|new|   -+---+---+---+-
     // -+---+---+-   '   '   '   '
     //  '   '   '
-    void push_neighbor_tasks(pos_t pos_p, int val_p, int dx, int dy) {
+    void push_neighbor_tasks(tile_t &tile, pos_t pos_p, int val_p, int dx, int dy) {
         auto pos_q = pos_p.offset(dx, dy);
-        if (!buff.bounds().contains(pos_q)) return;
+        if (!tile.rect.contains(pos_q)) return;
         auto val_q = buff[pos_q];
-        if (val_q >= 2 && val_p != val_q) {
+        if (val_q != 0 && val_p != val_q) {
             if (dx != 0) {
-                push_task(pos_p.offset(0, -1), false);
-                push_task(pos_q.offset(0, -1), false);
-                push_task(pos_p.offset(0,  1), false);
-                push_task(pos_q.offset(0,  1), false);
+                push_task(tile, pos_p.offset(0, -1), false);
+                push_task(tile, pos_q.offset(0, -1), false);
+                push_task(tile, pos_p.offset(0,  1), false);
+                push_task(tile, pos_q.offset(0,  1), false);
             }
             else if (dy != 0) {
-                push_task(pos_p.offset(-1, 0), false);
-                push_task(pos_q.offset(-1, 0), false);
-                push_task(pos_p.offset( 1, 0), false);
-                push_task(pos_q.offset( 1, 0), false);
+                push_task(tile, pos_p.offset(-1, 0), false);
+                push_task(tile, pos_q.offset(-1, 0), false);
+                push_task(tile, pos_p.offset( 1, 0), false);
+                push_task(tile, pos_q.offset( 1, 0), false);
             }
         }
     }
+#endif
 };
 
-// mandelbrot calculation loop
-static count_t mandelbrot_func(elem_t a, elem_t b) {
-    elem_t x = 0, y = 0;
-    elem_t xx = 0;
-    elem_t yy = 0;
-    elem_t xy = 0;
-    int n = MAX_LOOPS;
-    do {
-#if MANDEL_ENABLE_FIXED_POINT
-#if MANDEL_ENABLE_MULT_SPLIT
-        int xysign = 1;
-        if (x < 0) { x = -x; xysign = -xysign; }
-        if (y < 0) { y = -y; xysign = -xysign; }
-
-        uint16_t xl = x & 0xffffu;
-        uint16_t xh = (x >> 16) & 0xffffu;
-        uint16_t yl = y & 0xffffu;
-        uint16_t yh = (y >> 16) & 0xffffu;
-
-        xy = (elem_t)xl * yl;
-        xy = (xy >> 16) & 0xffffu;
-        xy += (elem_t)xl * yh;
-        xy += (elem_t)xh * yl;
-        xy = (xy >> 8) & 0xffffffu;
-        xy += ((elem_t)xh * yh) << 8;
-        xy *= xysign;
-
-        xx = (elem_t)xl * xl;
-        xx = (xx >> 16) & 0xffffu;
-        xx += 2 * ((elem_t)xl * xh);
-        xx = (xx >> 8) & 0xffffffu;
-        xx += ((elem_t)xh * xh) << 8;
-        
-        yy = (elem_t)yl * yl;
-        yy = (yy >> 16) & 0xffffu;
-        yy += 2 * ((elem_t)yl * yh);
-        yy = (yy >> 8) & 0xffffffu;
-        yy += ((elem_t)yh * yh) << 8;
-#else
-        xy = (((int64_t)x * y) >> FIXED_POINT_POS) & 0xffffffffl;
-        xx = (((int64_t)x * x) >> FIXED_POINT_POS) & 0xffffffffl;
-        yy = (((int64_t)y * y) >> FIXED_POINT_POS) & 0xffffffffl;
+#if PICO_ON_DEVICE && MANDEL_ENABLE_STATIC_STORAGE
+static_assert(sizeof(TinyMandelbrot) <= DEVICE_MEMORY_BUDGET, "TinyMandelbrot does not fit in DEVICE_MEMORY_BUDGET");
 #endif
-#else
-        xy = x * y;
-        xx = x * x;
-        yy = y * y;
-#endif
-        x = xx - yy + a;
-        y = xy + xy + b;
-    } while (--n != 0 && xx + yy < FIXED(4));
-    return MAX_LOOPS - n;
-}
 
 } // namespace
 
@@ -5,21 +5,143 @@
 
 // 0: use float32
 // 1: use Q8.24 fixed point
+#ifndef MANDEL_ENABLE_FIXED_POINT
 #define MANDEL_ENABLE_FIXED_POINT (1)
+#endif
 
 // 0: a * b = (int64_t)a * b >> 24
 // 1: split multiplication into upper/lower words
+#ifndef MANDEL_ENABLE_MULT_SPLIT
 #define MANDEL_ENABLE_MULT_SPLIT  (1)
+#endif
+
+// scan modes
+#define MANDEL_SCAN_RASTER (0)
+#define MANDEL_SCAN_BORDER (1)
+#define MANDEL_SCAN_RECT   (2)
 
 // 0: raster scan
 // 1: calculate only pixels near edges
-#define MANDEL_ENABLE_BORDER_SCAN (1)
+// 2: subdivide rectangles and fill ones with uniform perimeters (Mariani-Silver)
+//    (guesses like 1 and gives the same image: fewer pixels after zoom with MANDEL_ENABLE_ZOOM_REUSE
+//     and no pixel queue, but slower full redraws)
+#ifndef MANDEL_SCAN_MODE
+#define MANDEL_SCAN_MODE (MANDEL_SCAN_BORDER)
+#endif
 
 // 0: always redraw entire screen
 // 1: aedraw only new areas
+#ifndef MANDEL_ENABLE_FAST_SCROLL
 #define MANDEL_ENABLE_FAST_SCROLL (1)
+#endif
+
+// 0: scroll moves the pixels in the buffer
+// 1: scroll moves the origin of the wrap-around buffer
+#ifndef MANDEL_ENABLE_WRAP_BUFFER
+#define MANDEL_ENABLE_WRAP_BUFFER (1)
+#endif
+
+// 0: calculate pixels one by one
+// 1: collect queued pixels and calculate them in batches (SIMD on x86 hosts)
+#ifndef MANDEL_ENABLE_BATCH
+#if defined(__SSE4_1__) || defined(__AVX2__)
+#define MANDEL_ENABLE_BATCH (1)
+#else
+#define MANDEL_ENABLE_BATCH (0)
+#endif
+#endif
+
+// 0: always calculate with elem_t
+// 1: select the cheapest kernel precision that is exact enough for the zoom level
+#ifndef MANDEL_ENABLE_PRECISION_TIERS
+#define MANDEL_ENABLE_PRECISION_TIERS (1)
+#endif
+
+// 0: the lowest precision tier is Q8.24
+// 1: use Q4.12 at shallow zoom levels (MANDEL_ENABLE_PRECISION_TIERS and MANDEL_ENABLE_FIXED_POINT)
+//    16bit lanes are twice as fast, but Q4.12 changes 1000-10000 pixels of the home and
+//    benchmark views against Q8.24 at every level it would be used for
+#ifndef MANDEL_ENABLE_Q12_TIER
+#define MANDEL_ENABLE_Q12_TIER (0)
+#endif
+
+// 0: calculate all pixels
+// 1: skip pixels in the main cardioid and the period-2 bulb
+#ifndef MANDEL_ENABLE_INTERIOR_CHECK
+#define MANDEL_ENABLE_INTERIOR_CHECK (1)
+#endif
+
+// 0: iterate up to the iteration limit
+// 1: stop iterating when the orbit becomes periodic (Brent's method)
+#ifndef MANDEL_ENABLE_PERIODICITY_CHECK
+#define MANDEL_ENABLE_PERIODICITY_CHECK (1)
+#endif
+
+// 0: 8bit loop counts (iteration limit up to 255)
+// 1: 16bit loop counts (iteration limit up to MAX_LOOPS)
+#ifndef MANDEL_ENABLE_WIDE_COUNT
+#define MANDEL_ENABLE_WIDE_COUNT (0)
+#endif
+
+// 0: fixed iteration limit (DEFAULT_LOOPS)
+// 1: adjust the iteration limit to the zoom level and the escape counts of the last frame
+#ifndef MANDEL_ENABLE_ADAPTIVE_LOOPS
+#define MANDEL_ENABLE_ADAPTIVE_LOOPS (1)
+#endif
+
+// 0: recalculate pixels that went off screen
+// 1: keep calculated pixels in an LRU cache of square tiles
+#ifndef MANDEL_ENABLE_TILE_CACHE
+#define MANDEL_ENABLE_TILE_CACHE (1)
+#endif
+
+// 0: calculate only pixels on the screen
+// 1: fill the tile cache around the screen in idle time (render_guard(), needs MANDEL_ENABLE_TILE_CACHE)
+#ifndef MANDEL_ENABLE_GUARD_BAND
+#define MANDEL_ENABLE_GUARD_BAND (1)
+#endif
+
+// 0: recalculate entire screen after zoom
+// 1: reuse pixels of the previous zoom level and show the others resampled until recalculated
+#ifndef MANDEL_ENABLE_ZOOM_REUSE
+#define MANDEL_ENABLE_ZOOM_REUSE (1)
+#endif
+
+// 0: pixels appear in the order of the scan
+// 1: after a jump, calculate the 1/8, 1/4 and 1/2 lattices first and show them as blocks
+//    (the blocks are previews: the scan of the frame decides every pixel between the lattice points)
+#ifndef MANDEL_ENABLE_PROGRESSIVE
+#define MANDEL_ENABLE_PROGRESSIVE (0)
+#endif
+
+// 0: zoom up to MAX_ZOOM
+// 1: zoom up to DEEP_MAX_ZOOM with perturbation beyond MAX_ZOOM
+#ifndef MANDEL_ENABLE_DEEP_ZOOM
+#define MANDEL_ENABLE_DEEP_ZOOM (1)
+#endif
+
+// 0: allocate the buffers of the engine on the heap
+// 1: keep the buffers in the TinyMandelbrot object (no heap use, sizeof(TinyMandelbrot) is the footprint)
+#ifndef MANDEL_ENABLE_STATIC_STORAGE
+#if PICO_ON_DEVICE
+#define MANDEL_ENABLE_STATIC_STORAGE (1)
+#else
+#define MANDEL_ENABLE_STATIC_STORAGE (0)
+#endif
+#endif
+
+// namespace of the code that depends on this configuration
+// (configurations compiled in different namespaces can be linked together)
+#ifndef MANDEL_NAMESPACE
+#define MANDEL_NAMESPACE tinymandelbrot
+#endif
+
+// benchmark position (Q8.24) and zoom level
+#define BENCHMARK_A (0xffd8849c)
+#define BENCHMARK_B (0xfef822ee)
+#define BENCHMARK_ZOOM (18)
 
-namespace tinymandelbrot {
+namespace MANDEL_NAMESPACE {
     
 #ifdef PIXEL_DOUBLE
     static constexpr int W = 120;
@@ -33,8 +155,65 @@ namespace tinymandelbrot {
     static constexpr int PIXEL_SCALE_BITS = 7; // clog2(W/2)
 #endif
 
-    // queue size = (1 << QUEUE_SIZE_BITS)
-    static constexpr int QUEUE_SIZE_BITS = 12;
+    // limit of |a| and |b| of the view position
+    // half of the view is at most 1 (PIXEL_SCALE_BITS), so the views beyond the limit
+    // have no pixel inside |a| < 2 and |b| < 2
+    static constexpr int VIEW_RANGE = 3;
+
+    // zoom levels per octave (set_zoom_level())
+    static constexpr int ZOOM_SUBSTEPS = 4;
+
+    // fraction bits of the pixel size at fractional zoom levels
+    // (COORD_POINT_POS - PIXEL_SCALE_BITS - DEEP_MAX_ZOOM must not be less than this)
+    static constexpr int ZOOM_MANTISSA_BITS = 12;
+
+    // number of horizontal bands rendered in parallel
+    static constexpr int RENDER_TILES = 4;
+
+    // queue size per tile = (1 << QUEUE_SIZE_BITS)
+    static constexpr int QUEUE_SIZE_BITS = 10;
+
+    // rectangles waiting for subdivision per tile (MANDEL_SCAN_RECT)
+    static constexpr int RECT_STACK_SIZE = 32;
+
+    // cache tile size = (1 << CACHE_TILE_BITS) (MANDEL_ENABLE_TILE_CACHE)
+    static constexpr int CACHE_TILE_BITS = 4;
+
+    // number of cache tiles (MANDEL_ENABLE_TILE_CACHE)
+    // a tile takes SIZE * SIZE * sizeof(count_t) + 40 bytes (296 bytes on the device)
+#if PICO_ON_DEVICE
+    static constexpr int CACHE_TILES = 32;
+#else
+    static constexpr int CACHE_TILES = 1024;
+#endif
+
+#if PICO_ON_DEVICE
+    // max size of TinyMandelbrot with MANDEL_ENABLE_STATIC_STORAGE
+    // RP2040 has 256 KB of main SRAM, the 240x240 RGB565 SCREEN of PicoSystem takes 112.5 KB
+    // and the SDK, the app and the heap keep the remaining 27.5 KB
+    static constexpr int DEVICE_MEMORY_BUDGET = 116 * 1024;
+#endif
+
+    // width of the band around the screen in cache tiles (MANDEL_ENABLE_GUARD_BAND)
+#if PICO_ON_DEVICE
+    static constexpr int GUARD_BAND_TILES = 1;
+#else
+    static constexpr int GUARD_BAND_TILES = 2;
+#endif
+
+    // max cache tiles kept for the band, the rest of the cache holds the tiles
+    // that went off screen (MANDEL_ENABLE_GUARD_BAND)
+    static constexpr int GUARD_BAND_MAX_TILES = CACHE_TILES / 2;
+
+    // lattice step of the first coarse pass (MANDEL_ENABLE_PROGRESSIVE, power of two)
+    static constexpr int PROGRESSIVE_STEP = 8;
+
+    // max number of pixels calculated together
+#if MANDEL_ENABLE_BATCH
+    static constexpr int BATCH_SIZE = 64;
+#else
+    static constexpr int BATCH_SIZE = 1;
+#endif
 
 #if MANDEL_ENABLE_FIXED_POINT
     // fixed point type
@@ -50,11 +229,65 @@ namespace tinymandelbrot {
     static constexpr int FIXED_POINT_POS = 0;
 #endif
 
+#if MANDEL_ENABLE_WIDE_COUNT
+    // mandelbrot calculation loop counter type
+    using count_t = uint16_t;
+
+    // upper bound of the iteration limit
+    static constexpr int MAX_LOOPS = 2048;
+#else
     // mandelbrot calculation loop counter type
     using count_t = uint8_t;
 
-    // max calculation loop count
-    static constexpr count_t MAX_LOOPS = 128;
+    // upper bound of the iteration limit
+    static constexpr int MAX_LOOPS = 255;
+#endif
+
+    // initial iteration limit
+    static constexpr int DEFAULT_LOOPS = 128;
+
+    // lower bound of the iteration limit at zoom level 0 (MANDEL_ENABLE_ADAPTIVE_LOOPS)
+    // the bound doubles every LOOPS_DOUBLING_ZOOM levels
+    static constexpr int MIN_LOOPS = 64;
+    static constexpr int LOOPS_DOUBLING_ZOOM = 8;
+
+    // the iteration limit is adjusted when at least this number of pixels escaped in a frame
+    // (MANDEL_ENABLE_ADAPTIVE_LOOPS)
+    static constexpr uint32_t LOOPS_ADAPT_MIN_PIXELS = 256;
+
+    // the iteration limit is doubled when more than 1 / LOOPS_RAISE_RATIO of escaped pixels
+    // escaped in the last quarter of the limit (MANDEL_ENABLE_ADAPTIVE_LOOPS)
+    static constexpr uint32_t LOOPS_RAISE_RATIO = 64;
+
+    // extra fraction bits below the pixel size required for the kernel precision
+    // (MANDEL_ENABLE_PRECISION_TIERS)
+    // Q8.24 differs from double on 1000-2000 pixels of the benchmark view up to zoom level 13
+    // and the difference doubles every level from 15, so double is used from level 13
+    static constexpr int PRECISION_GUARD_BITS = 5;
+
+    // first interval of orbit snapshots (MANDEL_ENABLE_PERIODICITY_CHECK)
+    // the interval doubles at each snapshot
+    static constexpr int PERIODICITY_CHECK_MIN = 8;
+
+    // view position type (Q4.60 fixed point)
+    using coord_t = int64_t;
+
+    // view position fixed point position
+    static constexpr int COORD_POINT_POS = 60;
+
+    // max zoom level (MANDEL_ENABLE_DEEP_ZOOM)
+    static constexpr int DEEP_MAX_ZOOM = 40;
+
+    // perturbation delta type (MANDEL_ENABLE_DEEP_ZOOM)
+    using delta_t = float;
+
+    // max reference orbits per tile including the one at the view center
+    // (MANDEL_ENABLE_DEEP_ZOOM, an orbit takes MAX_LOOPS * 3 * sizeof(delta_t) bytes)
+#if PICO_ON_DEVICE
+    static constexpr int MAX_REFERENCES = 2;
+#else
+    static constexpr int MAX_REFERENCES = 3;
+#endif
 
 };
 